@@ -0,0 +1,85 @@
+#include "bench.h"
+/*--------------------------------------------------------------------------------
+    AttachmentMap benchmarks.
+    Whole-mesh geometry as per-vertex loops through VertexAttachment::operator[], and as Eigen expressions
+    over AttachmentMap views of the positions (the SurfaceGeometry methods). The results should be the same.
+--------------------------------------------------------------------------------*/
+
+namespace {
+
+// Each function sets its result and returns the time it measured.
+void report_pair(const std::string &name, size_t items,
+                 const std::function<double(vec_t &)> &loop, const std::function<double(vec_t &)> &mapped)
+{
+    vec_t loop_result;
+    vec_t mapped_result;
+    Bench::report(name + " loop", Bench::best_of(5, [&]() { return loop(loop_result); }), items);
+    Bench::report(name + " AttachmentMap", Bench::best_of(5, [&]() { return mapped(mapped_result); }), items);
+    if (!loop_result.isApprox(mapped_result, 1e-5f)) {
+        fprintf(stderr, "bench error: %s: AttachmentMap result differs.\n", name.c_str());
+        exit(EXIT_FAILURE);
+    }
+}
+
+} // namespace
+
+
+BENCHMARK(attachment_map)
+{
+    for (auto &input : Bench::import_inputs()) {
+        auto &data = input.second;
+        SurfaceMesh mesh;
+        SurfaceGeometry geom(mesh);
+        geom.add_vertices(data.positions.data(), data.num_vertices());
+        std::string name = input.first + " ";
+
+        report_pair(name + "bounding box", mesh.num_vertices(), [&](vec_t &result) {
+            Bench::Timer timer;
+            vec_t box_min = vec_t::Constant(std::numeric_limits<float>::infinity());
+            vec_t box_max = vec_t::Constant(-std::numeric_limits<float>::infinity());
+            for (auto v : mesh.vertices()) {
+                box_min = box_min.cwiseMin(geom.position[v]);
+                box_max = box_max.cwiseMax(geom.position[v]);
+            }
+            result = box_max - box_min;
+            return timer.seconds();
+        }, [&](vec_t &result) {
+            Bench::Timer timer;
+            auto box = geom.bounding_box();
+            result = box.second - box.first;
+            return timer.seconds();
+        });
+
+        report_pair(name + "centroid", mesh.num_vertices(), [&](vec_t &result) {
+            Bench::Timer timer;
+            Eigen::Vector3d sum = Eigen::Vector3d::Zero();
+            for (auto v : mesh.vertices()) sum += geom.position[v].cast<double>();
+            result = (sum / double(mesh.num_vertices())).cast<float>();
+            return timer.seconds();
+        }, [&](vec_t &result) {
+            Bench::Timer timer;
+            result = geom.centroid();
+            return timer.seconds();
+        });
+
+        // The positions are restored before each transform (outside of the timing), so they don't drift between repeats.
+        Eigen::Affine3f transformation = Eigen::Translation3f(1, 2, 3) * Eigen::AngleAxisf(0.5f, vec_t(0, 0, 1));
+        std::vector<vec_t> original(geom.position.data_pointer(), geom.position.data_pointer() + mesh.num_vertices());
+        auto restore = [&]() { std::copy(original.begin(), original.end(), geom.position.data_pointer()); };
+        report_pair(name + "transform", mesh.num_vertices(), [&](vec_t &result) {
+            restore();
+            Bench::Timer timer;
+            for (auto v : mesh.vertices()) geom.position[v] = transformation * geom.position[v];
+            double seconds = timer.seconds();
+            result = geom.centroid();
+            return seconds;
+        }, [&](vec_t &result) {
+            restore();
+            Bench::Timer timer;
+            geom.transform(transformation);
+            double seconds = timer.seconds();
+            result = geom.centroid();
+            return seconds;
+        });
+    }
+}
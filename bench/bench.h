@@ -0,0 +1,101 @@
+#ifndef MESH_PROCESSING_BENCH_H
+#define MESH_PROCESSING_BENCH_H
+/*--------------------------------------------------------------------------------
+    mesh_processing_bench
+    A small benchmark harness. Benchmarks are registered with the BENCHMARK macro,
+    and are run in registration order by main().
+    usage:
+        mesh_processing_bench [--large] [--data <directory>] [--json <file>] [filter]
+    Only benchmarks whose name contains the filter string are run.
+    With --json, every reported result is also written to the file as JSON, for tracking regressions between versions.
+--------------------------------------------------------------------------------*/
+#include <chrono>
+#include <functional>
+#include <string>
+#include <vector>
+#include "mesh_processing/mesh_processing.h"
+
+namespace Bench {
+
+struct Options {
+    std::string data_directory; // Directory containing greenland_copy.mesh.
+    bool large;                 // Also run the large (~10M face) inputs.
+    std::string json_filename;  // Empty for no JSON output.
+    std::string filter;
+};
+const Options &options();
+
+
+struct Registration {
+    Registration(const char *name, void (*function)());
+};
+#define BENCHMARK(NAME) \
+    static void NAME(); \
+    static Bench::Registration NAME##_registration(#NAME, NAME); \
+    static void NAME()
+
+
+class Timer {
+public:
+    Timer() { start(); }
+    inline void start() { m_start = std::chrono::steady_clock::now(); }
+    inline double seconds() const {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - m_start).count();
+    }
+private:
+    std::chrono::steady_clock::time_point m_start;
+};
+
+// Run the function repeatedly, and return the best time in seconds.
+// The function returns the time it measured, so that it can exclude its own setup.
+double best_of(int repeats, const std::function<double()> &function);
+
+// Print a result line. items is the number of elements processed (for throughput), or 0.
+void report(const std::string &name, double seconds, size_t items = 0);
+
+
+/*--------------------------------------------------------------------------------
+    Benchmark inputs.
+--------------------------------------------------------------------------------*/
+// A flat indexed triangle list.
+struct TriangleData {
+    std::vector<float> positions; // x,y,z for each vertex.
+    std::vector<uint32_t> triangles; // Three vertex indices for each triangle.
+
+    inline size_t num_vertices() const { return positions.size() / 3; }
+    inline size_t num_triangles() const { return triangles.size() / 3; }
+};
+
+// Load a MEDIT .mesh file (vertices and triangles only).
+TriangleData load_medit(const std::string &filename);
+// x_nodes-by-y_nodes grid in the unit square, with two triangles per quad (as Enmesh::grid_mesh).
+TriangleData grid_triangles(int x_nodes, int y_nodes);
+// A closed unit UV sphere with num_rings rings of num_segments vertices between the poles (2*num_rings*num_segments triangles).
+TriangleData sphere_triangles(int num_rings, int num_segments);
+// A closed torus with major radius 1 and minor radius 1/3, with num_major*num_minor quads split into two triangles each.
+TriangleData torus_triangles(int num_major, int num_minor);
+
+// Randomly permute the vertex numbering and the triangle order, as for a mesh imported in arbitrary order.
+TriangleData shuffled(const TriangleData &data, unsigned int seed = 1);
+
+// The named inputs used by the import benchmarks: greenland_copy.mesh, and a ~10M face grid when --large is given.
+std::vector<std::pair<std::string, TriangleData>> import_inputs();
+// The inputs of the suite benchmark: grids, spheres and tori of ~10K, ~100K and ~1M faces (and ~10M with --large),
+// and greenland_copy.mesh. Each input is only generated when it is reached, to bound the memory in use.
+std::vector<std::pair<std::string, std::function<TriangleData()>>> suite_inputs();
+
+// Build the mesh one element at a time through add_vertex() and add_face().
+void add_triangles(SurfaceGeometry &geom, const TriangleData &data);
+// Build the mesh in bulk through add_vertices() and add_faces(). The mesh is left unlocked.
+void build_mesh(SurfaceGeometry &geom, const TriangleData &data);
+void build_mesh(SurfaceMesh &mesh, const TriangleData &data); // Connectivity only.
+
+// For each input, build a mesh (with positions) from it, lock it, and call function(name, data, geom).
+// name is the input's name followed by a space, as the prefix of the reported result names.
+typedef std::function<void(const std::string &name, const TriangleData &data, SurfaceGeometry &geom)> LockedInputFunction;
+void for_each_locked_input(const std::vector<std::pair<std::string, TriangleData>> &inputs, const LockedInputFunction &function);
+void for_each_locked_input(const LockedInputFunction &function); // Over import_inputs().
+
+} // namespace Bench
+
+#endif // MESH_PROCESSING_BENCH_H
@@ -0,0 +1,133 @@
+#include "bench.h"
+/*--------------------------------------------------------------------------------
+    Circulator benchmarks.
+    Each traversal is timed as a hand-written do-while loop and with the circulator range which replaces it,
+    with handles and with ids (UncheckedTraversal). The results should be the same.
+--------------------------------------------------------------------------------*/
+
+namespace {
+
+void report_pair(const std::string &name, size_t items,
+                 const std::function<size_t()> &hand_written, const std::function<size_t()> &circulator)
+{
+    size_t hand_written_result = 0;
+    size_t circulator_result = 0;
+    Bench::report(name + " hand-written", Bench::best_of(5, [&]() {
+        Bench::Timer timer;
+        hand_written_result = hand_written();
+        return timer.seconds();
+    }), items);
+    Bench::report(name + " circulator", Bench::best_of(5, [&]() {
+        Bench::Timer timer;
+        circulator_result = circulator();
+        return timer.seconds();
+    }), items);
+    if (hand_written_result != circulator_result) {
+        fprintf(stderr, "bench error: %s: circulator result differs.\n", name.c_str());
+        exit(EXIT_FAILURE);
+    }
+}
+
+} // namespace
+
+
+BENCHMARK(circulators)
+{
+    Bench::for_each_locked_input([&](const std::string &name, const Bench::TriangleData &, SurfaceGeometry &geom) {
+        SurfaceMesh &mesh = geom.mesh;
+
+        report_pair(name + "one-ring", mesh.num_halfedges(), [&]() {
+            size_t sum = 0;
+            for (auto v : mesh.vertices()) {
+                auto start = v.halfedge();
+                auto he = start;
+                do {
+                    sum += he.twin().vertex().index();
+                } while ((he = he.twin().next()) != start);
+            }
+            return sum;
+        }, [&]() {
+            size_t sum = 0;
+            for (auto v : mesh.vertices()) {
+                for (auto neighbour : v.one_ring()) sum += neighbour.index();
+            }
+            return sum;
+        });
+
+        report_pair(name + "one-ring ids", mesh.num_halfedges(), [&]() {
+            auto traversal = mesh.unchecked();
+            size_t sum = 0;
+            for (auto v : mesh.vertices()) {
+                auto start = traversal.halfedge(v.id());
+                auto he = start;
+                do {
+                    sum += traversal.vertex(traversal.twin(he)).index();
+                } while ((he = traversal.next(traversal.twin(he))) != start);
+            }
+            return sum;
+        }, [&]() {
+            auto traversal = mesh.unchecked();
+            size_t sum = 0;
+            for (auto v : mesh.vertices()) {
+                for (auto neighbour : traversal.one_ring(v.id())) sum += neighbour.index();
+            }
+            return sum;
+        });
+
+        report_pair(name + "fan", mesh.num_halfedges(), [&]() {
+            size_t sum = 0;
+            for (auto v : mesh.vertices()) {
+                auto start = v.halfedge();
+                auto he = start;
+                do {
+                    if (he.face().null()) break;
+                    sum += he.face().index();
+                } while ((he = he.twin().next()) != start);
+            }
+            return sum;
+        }, [&]() {
+            size_t sum = 0;
+            for (auto v : mesh.vertices()) {
+                for (auto face : v.fan()) sum += face.index();
+            }
+            return sum;
+        });
+
+        report_pair(name + "face vertices", mesh.num_halfedges(), [&]() {
+            size_t sum = 0;
+            for (auto face : mesh.faces()) {
+                auto start = face.halfedge();
+                auto he = start;
+                do {
+                    sum += he.vertex().index();
+                } while ((he = he.next()) != start);
+            }
+            return sum;
+        }, [&]() {
+            size_t sum = 0;
+            for (auto face : mesh.faces()) {
+                for (auto v : face.vertices()) sum += v.index();
+            }
+            return sum;
+        });
+
+        report_pair(name + "triangle vertices", mesh.num_halfedges(), [&]() {
+            size_t sum = 0;
+            for (auto face : mesh.faces()) {
+                auto he = face.halfedge();
+                sum += he.vertex().index();
+                he = he.next();
+                sum += he.vertex().index();
+                he = he.next();
+                sum += he.vertex().index();
+            }
+            return sum;
+        }, [&]() {
+            size_t sum = 0;
+            for (auto face : mesh.faces()) {
+                for (auto v : face.triangle_vertices()) sum += v.index();
+            }
+            return sum;
+        });
+    });
+}
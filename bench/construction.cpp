@@ -0,0 +1,29 @@
+#include "bench.h"
+/*--------------------------------------------------------------------------------
+    Construction benchmarks.
+    Incremental add_vertex()/add_face() construction against bulk construction from the flat index arrays.
+--------------------------------------------------------------------------------*/
+
+BENCHMARK(construction)
+{
+    for (auto &input : Bench::import_inputs()) {
+        auto &data = input.second;
+        double incremental_seconds = Bench::best_of(3, [&]() {
+            SurfaceMesh mesh;
+            SurfaceGeometry geom(mesh);
+            Bench::Timer timer;
+            Bench::add_triangles(geom, data);
+            return timer.seconds();
+        });
+        Bench::report(input.first + " incremental", incremental_seconds, data.num_triangles());
+
+        double bulk_seconds = Bench::best_of(3, [&]() {
+            SurfaceMesh mesh;
+            SurfaceGeometry geom(mesh);
+            Bench::Timer timer;
+            Bench::build_mesh(geom, data);
+            return timer.seconds();
+        });
+        Bench::report(input.first + " bulk", bulk_seconds, data.num_triangles());
+    }
+}
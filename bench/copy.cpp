@@ -0,0 +1,48 @@
+#include "bench.h"
+/*--------------------------------------------------------------------------------
+    Copy benchmarks.
+    A locked mesh with positions is copied with the copy constructor (into new storage) and with assignment
+    (into a mesh which already has the storage). Throughput is given in MB/s of element data (incidences, boundary
+    flags and positions, not counting the halfedge map), next to a plain memcpy of the same number of bytes.
+--------------------------------------------------------------------------------*/
+
+BENCHMARK(copy)
+{
+    Bench::for_each_locked_input([&](const std::string &name, const Bench::TriangleData &, SurfaceGeometry &geom) {
+        SurfaceMesh &mesh = geom.mesh;
+
+        size_t bytes = mesh.num_vertices() * (sizeof(VertexIncidenceData) + sizeof(uint8_t) + sizeof(vec_t))
+                     + mesh.num_halfedges() * sizeof(HalfedgeIncidenceData)
+                     + mesh.num_edges() * sizeof(EdgeIncidenceData)
+                     + mesh.num_faces() * sizeof(FaceIncidenceData);
+
+        std::vector<uint8_t> source(bytes, 1);
+        std::vector<uint8_t> destination(bytes, 0);
+        Bench::report(name + "memcpy (MB/s)", Bench::best_of(5, [&]() {
+            Bench::Timer timer;
+            memcpy(destination.data(), source.data(), bytes);
+            return timer.seconds();
+        }), bytes);
+
+        Bench::report(name + "copy constructor (MB/s)", Bench::best_of(5, [&]() {
+            Bench::Timer timer;
+            SurfaceMesh copy(mesh);
+            SurfaceGeometry copy_geom(copy, geom);
+            double seconds = timer.seconds();
+            if (copy.num_faces() != mesh.num_faces() || !copy.locked()) {
+                fprintf(stderr, "bench error: copy: copied mesh differs.\n");
+                exit(EXIT_FAILURE);
+            }
+            return seconds;
+        }), bytes);
+
+        SurfaceMesh assigned;
+        SurfaceGeometry assigned_geom(assigned);
+        Bench::report(name + "assignment (MB/s)", Bench::best_of(5, [&]() {
+            Bench::Timer timer;
+            assigned = mesh;
+            assigned_geom.position.copy(geom.position);
+            return timer.seconds();
+        }), bytes);
+    });
+}
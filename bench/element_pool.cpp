@@ -0,0 +1,216 @@
+#include <random>
+#include <memory>
+#include "bench.h"
+/*--------------------------------------------------------------------------------
+    ElementPool benchmarks.
+    Remeshing-style churn: a pool is filled, then single removes and adds are interleaved at random positions.
+--------------------------------------------------------------------------------*/
+
+namespace {
+
+// The allocation scheme ElementPool used before the free-list: a linear scan over std::vector<bool>
+// from the least index that might be inactive. Kept here as a reference for the churn benchmark.
+class ScanningPool {
+public:
+    ScanningPool() : active_flags(1), least_inactive_index{0} {}
+    ElementIndex add() {
+        ElementIndex index = least_inactive_index;
+        size_t n = active_flags.size();
+        for (; index < n; index++) {
+            if (!active_flags[index]) break;
+        }
+        if (index == n - 1) active_flags.resize(2*n, false);
+        active_flags[index] = true;
+        least_inactive_index = index+1;
+        return index;
+    }
+    void remove(ElementIndex index) {
+        if (index < least_inactive_index) least_inactive_index = index;
+        active_flags[index] = false;
+    }
+private:
+    std::vector<bool> active_flags;
+    ElementIndex least_inactive_index;
+};
+
+// Fill the pool with n elements, then do num_churn (remove random element, add element) pairs.
+template <typename Pool>
+double churn(size_t n, size_t num_churn)
+{
+    Pool pool;
+    std::vector<ElementIndex> elements(n);
+    for (size_t i = 0; i < n; i++) elements[i] = pool.add();
+    std::mt19937 rng(1);
+    Bench::Timer timer;
+    for (size_t i = 0; i < num_churn; i++) {
+        size_t k = rng() % n;
+        pool.remove(elements[k]);
+        elements[k] = pool.add();
+    }
+    return timer.seconds();
+}
+
+} // namespace
+
+
+BENCHMARK(element_pool_churn)
+{
+    const size_t num_churn = 100000;
+    for (size_t n : {10000, 100000, 1000000}) {
+        std::string size = std::to_string(n);
+        // The reference is O(n) per add under churn, so it is run with fewer operations.
+        const size_t num_reference_churn = 10000;
+        Bench::report("ScanningPool (reference) n=" + size, churn<ScanningPool>(n, num_reference_churn), num_reference_churn);
+        Bench::report("ElementPool n=" + size, Bench::best_of(3, [&]() { return churn<ElementPool>(n, num_churn); }), num_churn);
+    }
+
+    // Churn through SurfaceMesh, so that the pool's attachments are created and destroyed as well.
+    for (size_t n : {100000, 1000000}) {
+        double seconds = Bench::best_of(3, [&]() {
+            SurfaceMesh mesh;
+            SurfaceGeometry geom(mesh);
+            std::vector<Vertex> vertices(n);
+            for (size_t i = 0; i < n; i++) vertices[i] = mesh.add_vertex();
+            std::mt19937 rng(1);
+            Bench::Timer timer;
+            for (size_t i = 0; i < num_churn; i++) {
+                size_t k = rng() % n;
+                mesh.remove_vertex(vertices[k]);
+                vertices[k] = mesh.add_vertex();
+            }
+            return timer.seconds();
+        });
+        Bench::report("SurfaceMesh vertices n=" + std::to_string(n), seconds, num_churn);
+    }
+}
+
+
+BENCHMARK(element_pool_iteration)
+{
+    const size_t n = 4000000;
+    // Sum the active indices, for a dense pool and for pools with every k'th element removed.
+    for (size_t k : {0, 2, 64}) {
+        ElementPool pool(n);
+        for (size_t i = 0; i < n; i++) pool.add();
+        if (k > 0) {
+            for (size_t i = 0; i < n; i += k) pool.remove(i);
+        }
+        uint64_t sum = 0;
+        double seconds = Bench::best_of(5, [&]() {
+            Bench::Timer timer;
+            for (auto i = pool.begin(); i != pool.end(); ++i) sum += *i;
+            return timer.seconds();
+        });
+        if (sum == 0) printf("(empty)\n");
+        Bench::report(k == 0 ? std::string("dense") : "1 in " + std::to_string(k) + " removed", seconds, pool.num_elements());
+    }
+}
+
+
+BENCHMARK(element_pool_bulk_add)
+{
+    // Adding n vertices (each with a position) one at a time, with add_n(), and with add_n() after reserve().
+    for (size_t n : {100000, 1000000, 4000000}) {
+        std::string size = std::to_string(n);
+        Bench::report("add_vertex() n=" + size, Bench::best_of(3, [&]() {
+            SurfaceMesh mesh;
+            SurfaceGeometry geom(mesh);
+            Bench::Timer timer;
+            for (size_t i = 0; i < n; i++) mesh.add_vertex();
+            return timer.seconds();
+        }), n);
+        Bench::report("add_vertices() n=" + size, Bench::best_of(3, [&]() {
+            SurfaceMesh mesh;
+            SurfaceGeometry geom(mesh);
+            Bench::Timer timer;
+            mesh.add_vertices(n);
+            return timer.seconds();
+        }), n);
+        Bench::report("reserve() + add_vertex() n=" + size, Bench::best_of(3, [&]() {
+            SurfaceMesh mesh;
+            SurfaceGeometry geom(mesh);
+            Bench::Timer timer;
+            mesh.reserve(n, 0, 0);
+            for (size_t i = 0; i < n; i++) mesh.add_vertex();
+            return timer.seconds();
+        }), n);
+    }
+}
+
+
+BENCHMARK(attachment_fill)
+{
+    // Setting a per-vertex flag, element by element through the checked operator[], and with fill().
+    const size_t n = 4000000;
+    SurfaceMesh mesh;
+    mesh.add_vertices(n);
+    VertexAttachment<char> vertex_flags(mesh, false);
+    Bench::report("operator[] loop", Bench::best_of(5, [&]() {
+        Bench::Timer timer;
+        for (auto v : mesh.vertices()) vertex_flags[v] = true;
+        return timer.seconds();
+    }), n);
+    Bench::report("fill()", Bench::best_of(5, [&]() {
+        Bench::Timer timer;
+        vertex_flags.fill(true);
+        return timer.seconds();
+    }), n);
+    // Vertices added after the fill are given the default value.
+    ElementIndex first_new = mesh.add_vertices(n);
+    for (auto v : mesh.vertices()) {
+        if (vertex_flags[v] != (v.index() < first_new)) {
+            fprintf(stderr, "bench error: attachment_fill: wrong entry.\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+}
+
+
+namespace {
+
+// A float which is not trivially copyable, so its attachment entries are constructed and destroyed
+// per element through the virtual methods. This is the reference for the trivial attachment benchmark.
+struct NonTrivialFloat {
+    NonTrivialFloat() {}
+    NonTrivialFloat(const NonTrivialFloat &other) : value{other.value} {}
+    NonTrivialFloat &operator=(const NonTrivialFloat &other) { value = other.value; return *this; }
+    float value;
+};
+
+// Add n vertices one at a time to a mesh with 10 attachments of type T, then remove them all.
+template <typename T>
+void add_remove_vertices(const std::string &name, size_t n)
+{
+    double add_seconds = 0;
+    double remove_seconds = 0;
+    for (int trial = 0; trial < 3; trial++) {
+        SurfaceMesh mesh;
+        std::vector<std::unique_ptr<VertexAttachment<T>>> attachments;
+        for (int i = 0; i < 10; i++) {
+            attachments.emplace_back(new VertexAttachment<T>(mesh));
+        }
+        Bench::Timer add_timer;
+        for (size_t i = 0; i < n; i++) mesh.add_vertex();
+        double seconds = add_timer.seconds();
+        add_seconds = trial == 0 ? seconds : std::min(add_seconds, seconds);
+
+        Bench::Timer remove_timer;
+        for (size_t i = 0; i < n; i++) mesh.remove_vertex(Vertex(mesh, i));
+        seconds = remove_timer.seconds();
+        remove_seconds = trial == 0 ? seconds : std::min(remove_seconds, seconds);
+    }
+    Bench::report(name + " add n=" + std::to_string(n), add_seconds, n);
+    Bench::report(name + " remove n=" + std::to_string(n), remove_seconds, n);
+}
+
+} // namespace
+
+
+BENCHMARK(element_pool_trivial_attachments)
+{
+    // Attachments of trivial entries are not created or destroyed per element, and grow with realloc.
+    for (size_t n : {100000, 1000000}) {
+        add_remove_vertices<NonTrivialFloat>("non-trivial x10 (reference)", n);
+        add_remove_vertices<float>("trivial x10", n);
+    }
+}
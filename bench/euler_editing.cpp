@@ -0,0 +1,152 @@
+#include "bench.h"
+/*--------------------------------------------------------------------------------
+    Euler editing benchmarks.
+    A single triangle is added to a large locked mesh with add(SurfaceMesh &), then removed with
+    remove_connected_component(). Both keep the mesh locked and only touch the edited component,
+    so they should take microseconds, independent of the size of the mesh. A full lock() is timed for reference.
+    The local operators (flip, split, collapse) are timed on every edge of each input, and the edited meshes are checked.
+--------------------------------------------------------------------------------*/
+
+namespace {
+
+void fail(const std::string &name, const char *message)
+{
+    fprintf(stderr, "bench error: euler_operators: %s: %s\n", name.c_str(), message);
+    exit(EXIT_FAILURE);
+}
+
+// Check that the halfedges are consistent, the faces are non-degenerate triangles, and the Euler characteristic is kept.
+void check_mesh(const std::string &name, SurfaceMesh &mesh, long euler_characteristic)
+{
+    if (long(mesh.num_vertices()) - long(mesh.num_edges()) + long(mesh.num_faces()) != euler_characteristic) {
+        fail(name, "the Euler characteristic changed.");
+    }
+    for (auto he : mesh.halfedges()) {
+        if (he.twin().twin() != he || he.next().vertex() != he.twin().vertex()) fail(name, "inconsistent halfedges.");
+        if (he.face().null()) continue;
+        if (he.next().next().next() != he || he.next().face() != he.face()) fail(name, "a face is not a triangle.");
+        if (he.vertex() == he.next().vertex() || he.vertex() == he.next().next().vertex()) fail(name, "a degenerate face.");
+    }
+}
+
+// Collapses which would make the mesh non-manifold must be rejected.
+void check_collapse_rejections()
+{
+    // Every collapse of a tetrahedron would leave two faces on the same three vertices.
+    SurfaceMesh tetrahedron;
+    tetrahedron.add_vertices(4);
+    const ElementIndex tetrahedron_triangles[12] = {0,1,2, 0,3,1, 1,3,2, 0,2,3};
+    tetrahedron.add_faces(tetrahedron_triangles, 4, 3);
+    tetrahedron.lock();
+    for (auto he : tetrahedron.halfedges()) {
+        if (tetrahedron.collapse(he)) fail("tetrahedron", "a collapse was not rejected.");
+    }
+    check_mesh("tetrahedron", tetrahedron, 2);
+
+    // Collapsing the diagonal of a quad would remove both triangles, whose other two edges are on the boundary.
+    SurfaceMesh quad;
+    quad.add_vertices(4);
+    const ElementIndex quad_triangles[6] = {0,1,2, 0,2,3};
+    quad.add_faces(quad_triangles, 2, 3);
+    quad.lock();
+    for (auto he : quad.halfedges()) {
+        if (!he.face().null() && !he.twin().face().null() && quad.collapse(he)) fail("quad", "a collapse was not rejected.");
+    }
+    check_mesh("quad", quad, 1);
+}
+
+} // namespace
+
+BENCHMARK(euler_editing)
+{
+    auto inputs = Bench::import_inputs();
+    if (Bench::options().large) {
+        // ~5M faces.
+        inputs.emplace_back("grid_5M", Bench::grid_triangles(1582, 1582));
+    }
+    for (auto &input : inputs) {
+        auto &data = input.second;
+        std::string name = input.first + " ";
+
+        SurfaceMesh triangle;
+        auto a = triangle.add_vertex();
+        auto b = triangle.add_vertex();
+        auto c = triangle.add_vertex();
+        triangle.add_triangle(a, b, c);
+        triangle.lock();
+
+        SurfaceMesh mesh;
+        Bench::build_mesh(mesh, data);
+        Bench::Timer lock_timer;
+        mesh.lock();
+        Bench::report(name + "lock (reference)", lock_timer.seconds(), mesh.num_faces());
+
+        size_t num_faces = mesh.num_faces();
+        double add_seconds = 0;
+        double remove_seconds = Bench::best_of(20, [&]() {
+            Bench::Timer add_timer;
+            mesh.add(triangle);
+            add_seconds = add_seconds == 0 ? add_timer.seconds() : std::min(add_seconds, add_timer.seconds());
+            // Find the added face (untimed). It is the only face with vertices past the original mesh's vertices.
+            Face added_face(mesh, InvalidElementIndex);
+            for (auto face : mesh.faces()) {
+                if (face.halfedge().vertex().index() >= data.num_vertices()) added_face = face;
+            }
+            Bench::Timer remove_timer;
+            mesh.remove_connected_component(added_face);
+            return remove_timer.seconds();
+        });
+        if (!mesh.locked() || mesh.num_faces() != num_faces) {
+            fprintf(stderr, "bench error: euler_editing: mesh changed by add/remove.\n");
+            exit(EXIT_FAILURE);
+        }
+        Bench::report(name + "add 1-face mesh", add_seconds, 1);
+        Bench::report(name + "remove 1-face component", remove_seconds, 1);
+    }
+}
+
+
+BENCHMARK(euler_operators)
+{
+    check_collapse_rejections();
+    Bench::for_each_locked_input([&](const std::string &name, const Bench::TriangleData &data, SurfaceGeometry &geom) {
+        auto edge_list = [](SurfaceMesh &mesh) {
+            std::vector<Edge> edges;
+            for (auto edge : mesh.edges()) edges.push_back(edge);
+            return edges;
+        };
+
+        SurfaceMesh &mesh = geom.mesh;
+        long euler_characteristic = long(mesh.num_vertices()) - long(mesh.num_edges()) + long(mesh.num_faces());
+        auto edges = edge_list(mesh);
+        Bench::Timer flip_timer;
+        for (auto edge : edges) mesh.flip(edge);
+        Bench::report(name + "flip", flip_timer.seconds(), edges.size());
+        check_mesh(name + "flip", mesh, euler_characteristic);
+
+        std::vector<Vertex> split_vertices(edges.size());
+        Bench::Timer split_timer;
+        for (size_t i = 0; i < edges.size(); i++) split_vertices[i] = mesh.split(edges[i]);
+        Bench::report(name + "split edge", split_timer.seconds(), edges.size());
+        check_mesh(name + "split edge", mesh, euler_characteristic);
+
+        // Collapse an edge out of each new vertex. Only the collapsed vertex is removed, so the others stay valid.
+        size_t num_collapsed = 0;
+        Bench::Timer collapse_timer;
+        for (auto v : split_vertices) {
+            if (mesh.collapse(v.halfedge())) num_collapsed += 1;
+        }
+        Bench::report(name + "collapse", collapse_timer.seconds(), num_collapsed);
+        check_mesh(name + "collapse", mesh, euler_characteristic);
+
+        SurfaceMesh face_mesh;
+        Bench::build_mesh(face_mesh, data);
+        face_mesh.lock();
+        std::vector<Face> faces;
+        for (auto face : face_mesh.faces()) faces.push_back(face);
+        Bench::Timer face_split_timer;
+        for (auto face : faces) face_mesh.split(face);
+        Bench::report(name + "split face", face_split_timer.seconds(), faces.size());
+        check_mesh(name + "split face", face_mesh, euler_characteristic);
+    });
+}
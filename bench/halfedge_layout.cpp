@@ -0,0 +1,140 @@
+#include "bench.h"
+/*--------------------------------------------------------------------------------
+    Halfedge incidence layout benchmarks.
+    The traversal kernels are run over a copy of each import input's incidences in both the AoS and SoA layouts
+    (HalfedgeIncidenceAoS and HalfedgeIncidenceSoA can be used on their own, so both are compared in one binary).
+    Then lock() and Loop subdivision are timed for the layout the library was compiled with
+    (set halfedge_incidence_soa in CMakeLists.txt and rebuild to compare these).
+--------------------------------------------------------------------------------*/
+
+namespace {
+
+template <typename Layout>
+struct LayoutCopy {
+    ElementPool pool;
+    Layout incidence;
+    std::vector<ElementIndex> vertex_halfedges;
+
+    LayoutCopy(SurfaceMesh &mesh) :
+        pool(mesh.num_halfedges()),
+        incidence(pool)
+    {
+        assert(mesh.dense());
+        pool.add_n(mesh.num_halfedges());
+        for (auto he : mesh.halfedges()) {
+            ElementIndex i = he.index();
+            incidence.next(i) = he.next().index();
+            incidence.vertex(i) = he.vertex().index();
+            incidence.face(i) = he.face().index();
+            incidence.twin(i) = he.twin().index();
+            incidence.edge(i) = he.edge().index();
+        }
+        for (auto v : mesh.vertices()) {
+            vertex_halfedges.push_back(v.halfedge().index());
+        }
+    }
+
+    // Sum of the one-ring vertex indices of each vertex (twin, next and vertex).
+    size_t one_ring() const {
+        size_t sum = 0;
+        for (ElementIndex start : vertex_halfedges) {
+            ElementIndex he = start;
+            do {
+                sum += incidence.vertex(incidence.twin(he));
+                he = incidence.next(incidence.twin(he));
+            } while (he != start);
+        }
+        return sum;
+    }
+    // Degree of each vertex (twin and next only).
+    size_t valence() const {
+        size_t sum = 0;
+        for (ElementIndex start : vertex_halfedges) {
+            ElementIndex he = start;
+            do {
+                sum += 1;
+                he = incidence.next(incidence.twin(he));
+            } while (he != start);
+        }
+        return sum;
+    }
+    // The Loop edge-point stencil of each halfedge: both endpoints and both opposite vertices.
+    size_t edge_stencil() const {
+        size_t sum = 0;
+        for (ElementIndex he = 0; he < pool.end_index(); he++) {
+            ElementIndex twin = incidence.twin(he);
+            sum += incidence.vertex(he) + incidence.vertex(twin)
+                 + incidence.vertex(incidence.next(incidence.next(he)))
+                 + incidence.vertex(incidence.next(incidence.next(twin)));
+        }
+        return sum;
+    }
+};
+
+template <typename Layout>
+void run_kernels(const std::string &name, SurfaceMesh &mesh)
+{
+    LayoutCopy<Layout> copy(mesh);
+    std::string prefix = name + " " + Layout::layout_name() + " ";
+    volatile size_t sink = 0;
+    Bench::report(prefix + "valence", Bench::best_of(5, [&]() {
+        Bench::Timer timer;
+        sink = copy.valence();
+        return timer.seconds();
+    }), mesh.num_halfedges());
+    Bench::report(prefix + "one_ring", Bench::best_of(5, [&]() {
+        Bench::Timer timer;
+        sink = copy.one_ring();
+        return timer.seconds();
+    }), mesh.num_halfedges());
+    Bench::report(prefix + "edge_stencil", Bench::best_of(5, [&]() {
+        Bench::Timer timer;
+        sink = copy.edge_stencil();
+        return timer.seconds();
+    }), mesh.num_halfedges());
+    (void) sink;
+}
+
+} // namespace
+
+
+BENCHMARK(halfedge_layout)
+{
+    for (auto &input : Bench::import_inputs()) {
+        auto &data = input.second;
+        for (bool shuffle : {false, true}) {
+            auto input_data = shuffle ? Bench::shuffled(data) : data;
+            std::string name = input.first + (shuffle ? " shuffled" : "");
+            SurfaceMesh mesh;
+            Bench::build_mesh(mesh, input_data);
+            mesh.lock();
+            run_kernels<HalfedgeIncidenceAoS>(name, mesh);
+            run_kernels<HalfedgeIncidenceSoA>(name, mesh);
+        }
+
+        // Library operations, for the compiled-in layout.
+        std::string name = input.first + " library=" + HalfedgeIncidence::layout_name();
+        double lock_seconds = Bench::best_of(3, [&]() {
+            SurfaceMesh mesh;
+            Bench::build_mesh(mesh, data);
+            Bench::Timer timer;
+            mesh.lock();
+            return timer.seconds();
+        });
+        Bench::report(name + " lock", lock_seconds, data.num_triangles());
+
+        SurfaceMesh mesh;
+        SurfaceGeometry geom(mesh);
+        Bench::build_mesh(geom, data);
+        mesh.lock();
+        double subdivision_seconds = Bench::best_of(3, [&]() {
+            Bench::Timer timer;
+            Subdivision::Triangular subdiv(mesh);
+            SurfaceGeometry *subdiv_geom = Subdivision::loop(subdiv, geom);
+            double seconds = timer.seconds();
+            delete subdiv_geom;
+            return seconds;
+        });
+        Bench::report(name + " Triangular+loop", subdivision_seconds, data.num_triangles());
+    }
+}
@@ -0,0 +1,74 @@
+#include <map>
+#include "bench.h"
+/*--------------------------------------------------------------------------------
+    Halfedge map benchmarks.
+    The halfedge map access pattern of add_face() is replayed against VertexPairMap and
+    against the std::map it replaced: for each directed edge u->v of each triangle,
+    a duplicate check find(u,v), an insert(u,v), and a twin lookup find(v,u).
+--------------------------------------------------------------------------------*/
+
+namespace {
+
+template <typename Map, typename Find, typename Insert>
+double replay_add_face(const Bench::TriangleData &data, Find find, Insert insert)
+{
+    Map map;
+    Bench::Timer timer;
+    size_t num_twins = 0;
+    ElementIndex halfedge_index = 0;
+    for (size_t t = 0; t < data.num_triangles(); t++) {
+        const uint32_t *tri = &data.triangles[3*t];
+        for (int i = 0; i < 3; i++) {
+            uint32_t u = tri[i];
+            uint32_t v = tri[(i+1)%3];
+            assert(find(map, u, v) == InvalidElementIndex);
+            insert(map, u, v, halfedge_index++);
+            if (find(map, v, u) != InvalidElementIndex) num_twins += 1;
+        }
+    }
+    double seconds = timer.seconds();
+    if (num_twins == 0) printf("(no twins)\n"); // Keep the lookups from being optimized out.
+    return seconds;
+}
+
+typedef std::map<std::pair<ElementIndex, ElementIndex>, ElementIndex> StdMap;
+
+} // namespace
+
+
+BENCHMARK(halfedge_map)
+{
+    for (auto &input : Bench::import_inputs()) {
+        auto &data = input.second;
+        size_t num_halfedges = 3 * data.num_triangles();
+
+        double std_map_seconds = Bench::best_of(3, [&]() {
+            return replay_add_face<StdMap>(data,
+                [](StdMap &map, ElementIndex u, ElementIndex v) {
+                    auto found = map.find(std::pair<ElementIndex, ElementIndex>(u, v));
+                    return found == map.end() ? InvalidElementIndex : found->second;
+                },
+                [](StdMap &map, ElementIndex u, ElementIndex v, ElementIndex value) {
+                    map[std::pair<ElementIndex, ElementIndex>(u, v)] = value;
+                });
+        });
+        Bench::report(input.first + " std::map", std_map_seconds, num_halfedges);
+
+        double pair_map_seconds = Bench::best_of(3, [&]() {
+            return replay_add_face<VertexPairMap>(data,
+                [](VertexPairMap &map, ElementIndex u, ElementIndex v) { return map.find(u, v); },
+                [](VertexPairMap &map, ElementIndex u, ElementIndex v, ElementIndex value) { map.insert(u, v, value); });
+        });
+        Bench::report(input.first + " VertexPairMap", pair_map_seconds, num_halfedges);
+
+        // Full incremental import through add_vertex()/add_face().
+        double import_seconds = Bench::best_of(3, [&]() {
+            SurfaceMesh mesh;
+            SurfaceGeometry geom(mesh);
+            Bench::Timer timer;
+            Bench::add_triangles(geom, data);
+            return timer.seconds();
+        });
+        Bench::report(input.first + " add_face import", import_seconds, data.num_triangles());
+    }
+}
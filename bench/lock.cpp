@@ -0,0 +1,30 @@
+#include <thread>
+#include "bench.h"
+/*--------------------------------------------------------------------------------
+    lock() benchmarks.
+    Scaling of SurfaceMesh::lock() from 1 thread to the number of hardware threads.
+--------------------------------------------------------------------------------*/
+
+BENCHMARK(lock_scaling)
+{
+    unsigned int max_threads = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned int> thread_counts;
+    for (unsigned int n = 1; n < max_threads; n *= 2) thread_counts.push_back(n);
+    thread_counts.push_back(max_threads);
+
+    for (auto &input : Bench::import_inputs()) {
+        auto &data = input.second;
+        for (unsigned int num_threads : thread_counts) {
+            Parallel::set_num_threads(num_threads);
+            double seconds = Bench::best_of(3, [&]() {
+                SurfaceMesh mesh;
+                Bench::build_mesh(mesh, data);
+                Bench::Timer timer;
+                mesh.lock();
+                return timer.seconds();
+            });
+            Bench::report(input.first + " threads=" + std::to_string(num_threads), seconds, data.num_triangles());
+        }
+    }
+    Parallel::set_num_threads(0);
+}
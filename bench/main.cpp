@@ -0,0 +1,118 @@
+#include <stdio.h>
+#include <string.h>
+#include "bench.h"
+
+namespace Bench {
+
+struct RegisteredBenchmark {
+    const char *name;
+    void (*function)();
+};
+// Function-local static, so that registration works regardless of static initialization order.
+static std::vector<RegisteredBenchmark> &registered_benchmarks()
+{
+    static std::vector<RegisteredBenchmark> benchmarks;
+    return benchmarks;
+}
+
+Registration::Registration(const char *name, void (*function)())
+{
+    registered_benchmarks().push_back({name, function});
+}
+
+static Options g_options;
+const Options &options()
+{
+    return g_options;
+}
+
+// The results reported so far, for the JSON output.
+struct Result {
+    std::string benchmark;
+    std::string name;
+    double seconds;
+    size_t items;
+};
+static std::vector<Result> g_results;
+static const char *g_current_benchmark = "";
+
+double best_of(int repeats, const std::function<double()> &function)
+{
+    double best = std::numeric_limits<double>::infinity();
+    for (int i = 0; i < repeats; i++) {
+        best = std::min(best, function());
+    }
+    return best;
+}
+
+void report(const std::string &name, double seconds, size_t items)
+{
+    g_results.push_back({g_current_benchmark, name, seconds, items});
+    if (items > 0) {
+        printf("    %-48s %10.3f ms  %8.2f M/s\n", name.c_str(), 1000*seconds, items / seconds * 1e-6);
+    } else {
+        printf("    %-48s %10.3f ms\n", name.c_str(), 1000*seconds);
+    }
+    fflush(stdout);
+}
+
+static void write_json_string(FILE *file, const std::string &string)
+{
+    fputc('"', file);
+    for (char c : string) {
+        if (c == '"' || c == '\\') fputc('\\', file);
+        fputc(c, file);
+    }
+    fputc('"', file);
+}
+
+// Write the results, and the configuration they were measured with.
+static bool write_json(const std::string &filename)
+{
+    FILE *file = fopen(filename.c_str(), "w");
+    if (file == nullptr) return false;
+    fprintf(file, "{\n  \"threads\": %u,\n  \"halfedge_layout\": \"%s\",\n  \"traversal_checks\": %s,\n  \"results\": [\n",
+            Parallel::num_threads(), HalfedgeIncidence::layout_name(), MESH_PROCESSING_TRAVERSAL_CHECKS ? "true" : "false");
+    for (size_t i = 0; i < g_results.size(); i++) {
+        const Result &result = g_results[i];
+        fprintf(file, "    {\"benchmark\": ");
+        write_json_string(file, result.benchmark);
+        fprintf(file, ", \"name\": ");
+        write_json_string(file, result.name);
+        fprintf(file, ", \"seconds\": %.9g, \"items\": %zu", result.seconds, result.items);
+        if (result.items > 0) fprintf(file, ", \"items_per_second\": %.6g", result.items / result.seconds);
+        fprintf(file, "}%s\n", i + 1 < g_results.size() ? "," : "");
+    }
+    fprintf(file, "  ]\n}\n");
+    return fclose(file) == 0;
+}
+
+} // namespace Bench
+
+
+int main(int argc, char *argv[])
+{
+    Bench::g_options.data_directory = "../examples/simple1/";
+    Bench::g_options.large = false;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--large") == 0) {
+            Bench::g_options.large = true;
+        } else if (strcmp(argv[i], "--data") == 0 && i+1 < argc) {
+            Bench::g_options.data_directory = std::string(argv[++i]) + "/";
+        } else if (strcmp(argv[i], "--json") == 0 && i+1 < argc) {
+            Bench::g_options.json_filename = argv[++i];
+        } else {
+            Bench::g_options.filter = argv[i];
+        }
+    }
+    for (auto &benchmark : Bench::registered_benchmarks()) {
+        if (std::string(benchmark.name).find(Bench::g_options.filter) == std::string::npos) continue;
+        printf("%s\n", benchmark.name);
+        Bench::g_current_benchmark = benchmark.name;
+        benchmark.function();
+    }
+    if (!Bench::g_options.json_filename.empty() && !Bench::write_json(Bench::g_options.json_filename)) {
+        fprintf(stderr, "bench error: Could not write \"%s\".\n", Bench::g_options.json_filename.c_str());
+        return EXIT_FAILURE;
+    }
+}
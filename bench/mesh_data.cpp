@@ -0,0 +1,249 @@
+#include <stdio.h>
+#include <string.h>
+#include <random>
+#include "bench.h"
+
+namespace Bench {
+
+TriangleData load_medit(const std::string &filename)
+{
+    TriangleData data;
+    std::ifstream in(filename);
+    if (!in) {
+        std::cerr << "bench error: Could not open \"" << filename << "\".\n";
+        exit(EXIT_FAILURE);
+    }
+    int dimension = 3;
+    std::string keyword;
+    while (in >> keyword) {
+        if (keyword == "Dimension") {
+            in >> dimension;
+        } else if (keyword == "Vertices") {
+            size_t n;
+            in >> n;
+            data.positions.resize(3*n);
+            std::getline(in, keyword); // Skip the rest of the count line.
+            // Each vertex line is the coordinates, possibly followed by a reference number.
+            // A line with more than 3 values is "x y z ref", otherwise the values are coordinates
+            // (padded with zeros, so two-dimensional meshes are embedded in the z = 0 plane).
+            std::string line;
+            for (size_t i = 0; i < n; i++) {
+                std::getline(in, line);
+                float values[4] = {0, 0, 0, 0};
+                int num_values = sscanf(line.c_str(), "%f %f %f %f", &values[0], &values[1], &values[2], &values[3]);
+                if (num_values < 4 && dimension == 2) values[2] = 0; // "x y ref"
+                for (int j = 0; j < 3; j++) data.positions[3*i + j] = values[j];
+            }
+        } else if (keyword == "Triangles") {
+            size_t n;
+            in >> n;
+            data.triangles.resize(3*n);
+            for (size_t i = 0; i < 3*n; i++) in >> data.triangles[i];
+        } else if (keyword == "End") {
+            break;
+        }
+    }
+    return data;
+}
+
+
+TriangleData grid_triangles(int x_nodes, int y_nodes)
+{
+    assert(x_nodes > 1 && y_nodes > 1);
+    TriangleData data;
+    data.positions.resize(3 * x_nodes * y_nodes);
+    for (int j = 0; j < y_nodes; j++) {
+        for (int i = 0; i < x_nodes; i++) {
+            float *p = &data.positions[3*(x_nodes*j + i)];
+            p[0] = i / float(x_nodes - 1);
+            p[1] = j / float(y_nodes - 1);
+            p[2] = 0;
+        }
+    }
+    data.triangles.reserve(6 * (x_nodes-1) * (y_nodes-1));
+    for (int j = 0; j < y_nodes-1; j++) {
+        for (int i = 0; i < x_nodes-1; i++) {
+            uint32_t bl = x_nodes*j + i;
+            uint32_t br = x_nodes*j + i+1;
+            uint32_t tr = x_nodes*(j+1) + i+1;
+            uint32_t tl = x_nodes*(j+1) + i;
+            uint32_t tris[6] = {bl, br, tr, bl, tr, tl};
+            data.triangles.insert(data.triangles.end(), tris, tris+6);
+        }
+    }
+    return data;
+}
+
+
+TriangleData sphere_triangles(int num_rings, int num_segments)
+{
+    assert(num_rings > 0 && num_segments > 2);
+    // Vertex 0 is the north pole, then the rings from north to south, then the south pole.
+    TriangleData data;
+    data.positions.reserve(3 * (2 + num_rings * num_segments));
+    data.positions.insert(data.positions.end(), {0, 0, 1});
+    for (int k = 1; k <= num_rings; k++) {
+        float theta = M_PI * k / (num_rings + 1);
+        for (int j = 0; j < num_segments; j++) {
+            float phi = 2 * M_PI * j / num_segments;
+            data.positions.insert(data.positions.end(), {sinf(theta) * cosf(phi), sinf(theta) * sinf(phi), cosf(theta)});
+        }
+    }
+    data.positions.insert(data.positions.end(), {0, 0, -1});
+    uint32_t south = 1 + num_rings * num_segments;
+    auto ring_vertex = [&](int k, int j) { return uint32_t(1 + (k - 1) * num_segments + j % num_segments); };
+
+    data.triangles.reserve(6 * num_rings * num_segments);
+    for (int j = 0; j < num_segments; j++) {
+        uint32_t tri[3] = {0, ring_vertex(1, j), ring_vertex(1, j+1)};
+        data.triangles.insert(data.triangles.end(), tri, tri+3);
+    }
+    for (int k = 1; k < num_rings; k++) {
+        for (int j = 0; j < num_segments; j++) {
+            uint32_t a = ring_vertex(k, j);
+            uint32_t b = ring_vertex(k, j+1);
+            uint32_t c = ring_vertex(k+1, j+1);
+            uint32_t d = ring_vertex(k+1, j);
+            uint32_t tris[6] = {a, d, c, a, c, b};
+            data.triangles.insert(data.triangles.end(), tris, tris+6);
+        }
+    }
+    for (int j = 0; j < num_segments; j++) {
+        uint32_t tri[3] = {south, ring_vertex(num_rings, j+1), ring_vertex(num_rings, j)};
+        data.triangles.insert(data.triangles.end(), tri, tri+3);
+    }
+    return data;
+}
+
+
+TriangleData torus_triangles(int num_major, int num_minor)
+{
+    assert(num_major > 2 && num_minor > 2);
+    TriangleData data;
+    data.positions.resize(3 * num_major * num_minor);
+    for (int i = 0; i < num_major; i++) {
+        float u = 2 * M_PI * i / num_major;
+        for (int j = 0; j < num_minor; j++) {
+            float v = 2 * M_PI * j / num_minor;
+            float r = 1 + cosf(v) / 3;
+            float *p = &data.positions[3*(num_minor*i + j)];
+            p[0] = r * cosf(u);
+            p[1] = r * sinf(u);
+            p[2] = sinf(v) / 3;
+        }
+    }
+    // A grid of quads which wraps around in both directions.
+    auto vertex = [&](int i, int j) { return uint32_t(num_minor * (i % num_major) + j % num_minor); };
+    data.triangles.reserve(6 * num_major * num_minor);
+    for (int i = 0; i < num_major; i++) {
+        for (int j = 0; j < num_minor; j++) {
+            uint32_t a = vertex(i, j);
+            uint32_t b = vertex(i+1, j);
+            uint32_t c = vertex(i+1, j+1);
+            uint32_t d = vertex(i, j+1);
+            uint32_t tris[6] = {a, b, c, a, c, d};
+            data.triangles.insert(data.triangles.end(), tris, tris+6);
+        }
+    }
+    return data;
+}
+
+
+TriangleData shuffled(const TriangleData &data, unsigned int seed)
+{
+    std::mt19937 rng(seed);
+    auto vertex_permutation = std::vector<uint32_t>(data.num_vertices());
+    for (size_t i = 0; i < vertex_permutation.size(); i++) vertex_permutation[i] = i;
+    std::shuffle(vertex_permutation.begin(), vertex_permutation.end(), rng);
+    auto triangle_order = std::vector<uint32_t>(data.num_triangles());
+    for (size_t i = 0; i < triangle_order.size(); i++) triangle_order[i] = i;
+    std::shuffle(triangle_order.begin(), triangle_order.end(), rng);
+
+    TriangleData shuffled_data;
+    shuffled_data.positions.resize(data.positions.size());
+    for (size_t i = 0; i < data.num_vertices(); i++) {
+        for (int j = 0; j < 3; j++) shuffled_data.positions[3*vertex_permutation[i] + j] = data.positions[3*i + j];
+    }
+    shuffled_data.triangles.resize(data.triangles.size());
+    for (size_t i = 0; i < data.num_triangles(); i++) {
+        for (int j = 0; j < 3; j++) shuffled_data.triangles[3*i + j] = vertex_permutation[data.triangles[3*triangle_order[i] + j]];
+    }
+    return shuffled_data;
+}
+
+
+std::vector<std::pair<std::string, TriangleData>> import_inputs()
+{
+    std::vector<std::pair<std::string, TriangleData>> inputs;
+    inputs.emplace_back("greenland", load_medit(options().data_directory + "greenland_copy.mesh"));
+    if (options().large) {
+        // 2237x2237 nodes gives 2*2236^2 ~= 10M triangles.
+        inputs.emplace_back("grid_10M", grid_triangles(2237, 2237));
+    }
+    return inputs;
+}
+
+
+std::vector<std::pair<std::string, std::function<TriangleData()>>> suite_inputs()
+{
+    std::vector<std::pair<std::string, std::function<TriangleData()>>> inputs;
+    std::vector<std::pair<std::string, size_t>> sizes = {{"10K", 10000}, {"100K", 100000}, {"1M", 1000000}};
+    if (options().large) sizes.emplace_back("10M", 10000000);
+    for (auto &size : sizes) {
+        size_t num_faces = size.second;
+        // A grid has 2(n-1)^2 faces, and the sphere and torus (with twice as many segments as rings) have 4n^2.
+        int grid_nodes = int(sqrt(num_faces / 2.0)) + 1;
+        int n = int(sqrt(num_faces / 4.0));
+        inputs.emplace_back("grid_" + size.first, [=]() { return grid_triangles(grid_nodes, grid_nodes); });
+        inputs.emplace_back("sphere_" + size.first, [=]() { return sphere_triangles(n, 2*n); });
+        inputs.emplace_back("torus_" + size.first, [=]() { return torus_triangles(2*n, n); });
+    }
+    inputs.emplace_back("greenland", []() { return load_medit(options().data_directory + "greenland_copy.mesh"); });
+    return inputs;
+}
+
+
+void add_triangles(SurfaceGeometry &geom, const TriangleData &data)
+{
+    std::vector<Vertex> vertices(data.num_vertices());
+    for (size_t i = 0; i < data.num_vertices(); i++) {
+        vertices[i] = geom.mesh.add_vertex();
+        const float *p = &data.positions[3*i];
+        geom.position[vertices[i]] = vec_t(p[0], p[1], p[2]);
+    }
+    for (size_t i = 0; i < data.num_triangles(); i++) {
+        const uint32_t *t = &data.triangles[3*i];
+        geom.mesh.add_triangle(vertices[t[0]], vertices[t[1]], vertices[t[2]]);
+    }
+}
+
+void build_mesh(SurfaceGeometry &geom, const TriangleData &data)
+{
+    geom.add_vertices(data.positions.data(), data.num_vertices());
+    geom.mesh.add_faces(data.triangles.data(), data.num_triangles(), 3);
+}
+
+void build_mesh(SurfaceMesh &mesh, const TriangleData &data)
+{
+    mesh.add_vertices(data.num_vertices());
+    mesh.add_faces(data.triangles.data(), data.num_triangles(), 3);
+}
+
+
+void for_each_locked_input(const std::vector<std::pair<std::string, TriangleData>> &inputs, const LockedInputFunction &function)
+{
+    for (auto &input : inputs) {
+        SurfaceMesh mesh;
+        SurfaceGeometry geom(mesh);
+        build_mesh(geom, input.second);
+        mesh.lock();
+        function(input.first + " ", input.second, geom);
+    }
+}
+
+void for_each_locked_input(const LockedInputFunction &function)
+{
+    for_each_locked_input(import_inputs(), function);
+}
+
+} // namespace Bench
@@ -0,0 +1,125 @@
+#include "bench.h"
+#include <cstring>
+#include <thread>
+/*--------------------------------------------------------------------------------
+    Parallel scaling benchmarks.
+    The loops ported to ElementContainer::parallel_for and the Parallel helpers are timed with
+    1, 2, 4, ... threads, up to the hardware concurrency. The results must not depend on the thread count:
+    Loop subdivision and the one-ring averages write each entry once, and the centroid is a deterministic reduction,
+    so all of them are compared bitwise against the single-threaded results.
+--------------------------------------------------------------------------------*/
+
+namespace {
+
+std::vector<unsigned int> thread_counts()
+{
+    unsigned int hardware = std::max(1u, std::thread::hardware_concurrency());
+    std::vector<unsigned int> counts;
+    for (unsigned int n = 1; n < hardware; n *= 2) counts.push_back(n);
+    counts.push_back(hardware);
+    return counts;
+}
+
+void check_same(const std::string &name, const std::vector<vec_t> &expected, const std::vector<vec_t> &result)
+{
+    if (expected.size() != result.size() || memcmp(expected.data(), result.data(), expected.size() * sizeof(vec_t)) != 0) {
+        fprintf(stderr, "bench error: %s: result depends on the number of threads.\n", name.c_str());
+        exit(EXIT_FAILURE);
+    }
+}
+
+} // namespace
+
+
+BENCHMARK(parallel)
+{
+    Bench::for_each_locked_input([&](const std::string &input_name, const Bench::TriangleData &, SurfaceGeometry &geom) {
+        SurfaceMesh &mesh = geom.mesh;
+        Subdivision::Triangular subdiv(mesh);
+
+        std::vector<vec_t> original(geom.position.data_pointer(), geom.position.data_pointer() + mesh.num_vertices());
+        auto restore = [&]() { std::copy(original.begin(), original.end(), geom.position.data_pointer()); };
+        Eigen::Affine3f transformation = Eigen::Translation3f(1, 2, 3) * Eigen::AngleAxisf(0.5f, vec_t(0, 0, 1));
+
+        std::vector<vec_t> expected_loop;
+        std::vector<vec_t> expected_average;
+        std::vector<vec_t> expected_centroid;
+        for (unsigned int threads : thread_counts()) {
+            Parallel::set_num_threads(threads);
+            std::string name = input_name + std::to_string(threads) + " threads ";
+
+            std::vector<vec_t> loop_result;
+            double loop_seconds = Bench::best_of(3, [&]() {
+                Bench::Timer timer;
+                SurfaceGeometry *subdiv_geom = Subdivision::loop(subdiv, geom);
+                double seconds = timer.seconds();
+                auto positions = subdiv_geom->position.data_pointer();
+                loop_result.assign(positions, positions + subdiv.mesh().num_vertices());
+                delete subdiv_geom;
+                return seconds;
+            });
+            Bench::report(name + "loop", loop_seconds, mesh.num_faces());
+
+            // The average of the one-ring of each vertex.
+            VertexAttachment<vec_t> average(mesh);
+            double average_seconds = Bench::best_of(5, [&]() {
+                Bench::Timer timer;
+                auto traversal = mesh.unchecked();
+                mesh.vertices().parallel_for([&](Vertex v) {
+                    vec_t sum = vec_t::Zero();
+                    size_t n = 0;
+                    for (auto neighbour : traversal.one_ring(v.id())) {
+                        sum += geom.position[neighbour];
+                        n += 1;
+                    }
+                    average[v] = sum / float(n);
+                });
+                return timer.seconds();
+            });
+            Bench::report(name + "one-ring average", average_seconds, mesh.num_vertices());
+            std::vector<vec_t> average_result(average.data_pointer(), average.data_pointer() + mesh.num_vertices());
+
+            double bounding_box_seconds = Bench::best_of(5, [&]() {
+                Bench::Timer timer;
+                geom.bounding_box();
+                return timer.seconds();
+            });
+            Bench::report(name + "bounding box", bounding_box_seconds, mesh.num_vertices());
+
+            std::vector<vec_t> centroid_result(1);
+            double centroid_seconds = Bench::best_of(5, [&]() {
+                Bench::Timer timer;
+                centroid_result[0] = geom.centroid();
+                return timer.seconds();
+            });
+            Bench::report(name + "centroid", centroid_seconds, mesh.num_vertices());
+
+            double transform_seconds = Bench::best_of(5, [&]() {
+                restore();
+                Bench::Timer timer;
+                geom.transform(transformation);
+                return timer.seconds();
+            });
+            restore();
+            Bench::report(name + "transform", transform_seconds, mesh.num_vertices());
+
+            double compact_seconds = Bench::best_of(3, [&]() {
+                Bench::Timer timer;
+                CompactTriangleMesh compact(geom);
+                return timer.seconds();
+            });
+            Bench::report(name + "CompactTriangleMesh", compact_seconds, mesh.num_faces());
+
+            if (expected_loop.empty()) {
+                expected_loop = loop_result;
+                expected_average = average_result;
+                expected_centroid = centroid_result;
+            } else {
+                check_same(name + "loop", expected_loop, loop_result);
+                check_same(name + "one-ring average", expected_average, average_result);
+                check_same(name + "centroid", expected_centroid, centroid_result);
+            }
+        }
+        Parallel::set_num_threads(0);
+    });
+}
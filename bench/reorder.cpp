@@ -0,0 +1,51 @@
+#include "bench.h"
+/*--------------------------------------------------------------------------------
+    Reordering benchmarks.
+    The import inputs are shuffled (as meshes imported through assimp or STL come in arbitrary order),
+    then lock() and Loop subdivision are timed with and without SurfaceGeometry::spatial_reorder().
+--------------------------------------------------------------------------------*/
+
+BENCHMARK(reorder)
+{
+    for (auto &input : Bench::import_inputs()) {
+        auto data = Bench::shuffled(input.second);
+        for (bool reorder : {false, true}) {
+            std::string name = input.first + (reorder ? " reordered" : " shuffled");
+
+            double lock_seconds = Bench::best_of(3, [&]() {
+                SurfaceMesh mesh;
+                SurfaceGeometry geom(mesh);
+                Bench::build_mesh(geom, data);
+                if (reorder) geom.spatial_reorder();
+                Bench::Timer timer;
+                mesh.lock();
+                return timer.seconds();
+            });
+            Bench::report(name + " lock", lock_seconds, data.num_triangles());
+
+            SurfaceMesh mesh;
+            SurfaceGeometry geom(mesh);
+            Bench::build_mesh(geom, data);
+            if (reorder) geom.spatial_reorder();
+            mesh.lock();
+            double subdivision_seconds = Bench::best_of(3, [&]() {
+                Bench::Timer timer;
+                Subdivision::Triangular subdiv(mesh);
+                SurfaceGeometry *subdiv_geom = Subdivision::loop(subdiv, geom);
+                double seconds = timer.seconds();
+                delete subdiv_geom;
+                return seconds;
+            });
+            Bench::report(name + " Triangular+loop", subdivision_seconds, data.num_triangles());
+        }
+        double reorder_seconds = Bench::best_of(3, [&]() {
+            SurfaceMesh mesh;
+            SurfaceGeometry geom(mesh);
+            Bench::build_mesh(geom, data);
+            Bench::Timer timer;
+            geom.spatial_reorder();
+            return timer.seconds();
+        });
+        Bench::report(input.first + " spatial_reorder", reorder_seconds, data.num_triangles());
+    }
+}
@@ -0,0 +1,49 @@
+#include "bench.h"
+/*--------------------------------------------------------------------------------
+    Snapshot benchmarks.
+    Publishing a snapshot after a single flip only copies the chunks that changed. It is timed against the
+    first publish (which copies everything) and against a full copy of the mesh. Getting the latest snapshot
+    is timed for readers.
+--------------------------------------------------------------------------------*/
+
+BENCHMARK(snapshot)
+{
+    Bench::for_each_locked_input([&](const std::string &name, const Bench::TriangleData &, SurfaceGeometry &geom) {
+        SurfaceMesh &mesh = geom.mesh;
+
+        Bench::report(name + "full copy (reference)", Bench::best_of(3, [&]() {
+            Bench::Timer timer;
+            SurfaceMesh copy(mesh);
+            SurfaceGeometry copy_geom(copy, geom);
+            return timer.seconds();
+        }));
+
+        MeshVersions versions(mesh);
+        versions.track(geom.position);
+        Bench::Timer first_timer;
+        size_t first_bytes = versions.publish();
+        Bench::report(name + "first publish", first_timer.seconds());
+
+        size_t flip_bytes = 0;
+        std::vector<Edge> edges;
+        for (auto edge : mesh.edges()) edges.push_back(edge);
+        size_t edge_index = 0;
+        double flip_seconds = Bench::best_of(10, [&]() {
+            while (!mesh.flip(edges[edge_index++ % edges.size()])) {}
+            Bench::Timer timer;
+            flip_bytes = versions.publish();
+            return timer.seconds();
+        });
+        Bench::report(name + "publish after a flip", flip_seconds);
+        printf("    %-48s %10zu bytes copied (first publish: %zu)\n", (name + "publish after a flip").c_str(), flip_bytes, first_bytes);
+
+        size_t num_acquires = 100000;
+        volatile uint64_t sink = 0;
+        Bench::report(name + "snapshot()", Bench::best_of(3, [&]() {
+            Bench::Timer timer;
+            for (size_t i = 0; i < num_acquires; i++) sink = versions.snapshot()->version();
+            return timer.seconds();
+        }), num_acquires);
+        (void) sink;
+    });
+}
@@ -0,0 +1,104 @@
+#include "bench.h"
+#include <stdio.h>
+/*--------------------------------------------------------------------------------
+    Benchmark suite.
+    The main operations of the library, end to end, on generated grids, spheres and tori from ~10K to ~1M faces
+    (~10M with --large) and on greenland_copy.mesh: incremental and bulk construction, lock(), one-ring traversal,
+    Subdivision::Triangular and loop, CompactTriangleMesh and Enmesh::save_geometry.
+    Run with --json to record the results for comparison between versions.
+--------------------------------------------------------------------------------*/
+
+BENCHMARK(suite)
+{
+    for (auto &input : Bench::suite_inputs()) {
+        auto data = input.second();
+        const std::string &name = input.first;
+        size_t num_faces = data.num_triangles();
+        // The largest inputs take seconds per run, so are only run once.
+        int repeats = num_faces >= 1000000 ? 1 : 3;
+
+        double add_face_seconds = Bench::best_of(repeats, [&]() {
+            SurfaceMesh mesh;
+            SurfaceGeometry geom(mesh);
+            Bench::Timer timer;
+            Bench::add_triangles(geom, data);
+            return timer.seconds();
+        });
+        Bench::report(name + " add_face", add_face_seconds, num_faces);
+
+        double bulk_seconds = Bench::best_of(repeats, [&]() {
+            SurfaceMesh mesh;
+            SurfaceGeometry geom(mesh);
+            Bench::Timer timer;
+            Bench::build_mesh(geom, data);
+            return timer.seconds();
+        });
+        Bench::report(name + " bulk construction", bulk_seconds, num_faces);
+
+        double lock_seconds = Bench::best_of(repeats, [&]() {
+            SurfaceMesh mesh;
+            SurfaceGeometry geom(mesh);
+            Bench::build_mesh(geom, data);
+            Bench::Timer timer;
+            mesh.lock();
+            return timer.seconds();
+        });
+        Bench::report(name + " lock", lock_seconds, num_faces);
+
+        SurfaceMesh mesh;
+        SurfaceGeometry geom(mesh);
+        Bench::build_mesh(geom, data);
+        mesh.lock();
+        // The generated spheres and tori are closed, with Euler characteristics 2 and 0.
+        long euler_characteristic = long(mesh.num_vertices()) - long(mesh.num_edges()) + long(mesh.num_faces());
+        if ((name.compare(0, 6, "sphere") == 0 && (mesh.num_boundary_loops() != 0 || euler_characteristic != 2))
+            || (name.compare(0, 5, "torus") == 0 && (mesh.num_boundary_loops() != 0 || euler_characteristic != 0))) {
+            fprintf(stderr, "bench error: %s: generated mesh has the wrong topology.\n", name.c_str());
+            exit(EXIT_FAILURE);
+        }
+
+        size_t total_degree = 0;
+        double traversal_seconds = Bench::best_of(repeats, [&]() {
+            Bench::Timer timer;
+            size_t degree = 0;
+            for (auto v : mesh.vertices()) {
+                for (auto neighbour : v.one_ring()) {
+                    degree += neighbour.index() != InvalidElementIndex;
+                }
+            }
+            total_degree = degree;
+            return timer.seconds();
+        });
+        if (total_degree != mesh.num_halfedges()) {
+            fprintf(stderr, "bench error: %s: one-ring traversal visited %zu vertices.\n", name.c_str(), total_degree);
+            exit(EXIT_FAILURE);
+        }
+        Bench::report(name + " one-ring traversal", traversal_seconds, mesh.num_halfedges());
+
+        double subdivision_seconds = Bench::best_of(repeats, [&]() {
+            Bench::Timer timer;
+            Subdivision::Triangular subdiv(mesh);
+            SurfaceGeometry *subdiv_geom = Subdivision::loop(subdiv, geom);
+            double seconds = timer.seconds();
+            delete subdiv_geom;
+            return seconds;
+        });
+        Bench::report(name + " Triangular+loop", subdivision_seconds, num_faces);
+
+        double compact_seconds = Bench::best_of(repeats, [&]() {
+            Bench::Timer timer;
+            CompactTriangleMesh compact(geom);
+            return timer.seconds();
+        });
+        Bench::report(name + " CompactTriangleMesh", compact_seconds, num_faces);
+
+        const char *filename = "mesh_processing_bench_save_geometry.off";
+        double save_seconds = Bench::best_of(repeats, [&]() {
+            Bench::Timer timer;
+            Enmesh::save_geometry(geom, filename);
+            return timer.seconds();
+        });
+        remove(filename);
+        Bench::report(name + " save_geometry", save_seconds, num_faces);
+    }
+}
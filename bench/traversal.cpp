@@ -0,0 +1,119 @@
+#include "bench.h"
+/*--------------------------------------------------------------------------------
+    Traversal benchmarks.
+    The vertex and edge passes of Loop subdivision, written with handles, with the checked index-based
+    traversal of SurfaceMesh, and with UncheckedTraversal. Whether the first two are checked depends on the
+    build (see MESH_PROCESSING_TRAVERSAL_CHECKS), which is printed with the results.
+--------------------------------------------------------------------------------*/
+
+namespace {
+
+// Positions read through a pointer, to match UncheckedTraversal.
+struct PositionPointer {
+    const vec_t *position;
+    inline const vec_t &operator[](VertexId vertex) const { return position[vertex.index()]; }
+};
+
+inline float loop_beta(size_t n)
+{
+    float _c = 3+ 2*cos(2*M_PI/n);
+    return (5.f/8.f - (_c*_c)/64.f)/n;
+}
+
+// The vertex pass with handles (as Subdivision::loop was written).
+void vertex_pass_handles(SurfaceGeometry &geom, std::vector<vec_t> &out)
+{
+    for (auto v : geom.mesh.vertices()) {
+        size_t n = v.num_adjacent_vertices();
+        float beta = loop_beta(n);
+        vec_t pos = (1-n*beta) * geom.position[v];
+        auto start = v.halfedge();
+        auto he = start;
+        do {
+            pos += beta * geom.position[he.twin().vertex()];
+        } while ((he = he.twin().next()) != start);
+        out[v.index()] = pos;
+    }
+}
+void edge_pass_handles(SurfaceGeometry &geom, std::vector<vec_t> &out)
+{
+    for (auto edge : geom.mesh.edges()) {
+        auto end_a = geom.position[edge.a().vertex()];
+        auto end_b = geom.position[edge.b().vertex()];
+        auto wing_a = geom.position[edge.a().next().next().vertex()];
+        auto wing_b = geom.position[edge.b().next().next().vertex()];
+        out[edge.index()] = (1.0/8.0)*wing_a + (1.0/8.0)*wing_b + (3.0/8.0)*end_a + (3.0/8.0)*end_b;
+    }
+}
+
+// The passes with ids, for Traversal = SurfaceMesh (checked) or UncheckedTraversal.
+template <typename Traversal, typename Positions>
+void vertex_pass_ids(SurfaceMesh &mesh, const Traversal &traversal, const Positions &position, std::vector<vec_t> &out)
+{
+    for (auto v : mesh.vertices()) {
+        size_t n = traversal.num_adjacent_vertices(v.id());
+        float beta = loop_beta(n);
+        vec_t pos = (1-n*beta) * position[v.id()];
+        auto start = traversal.halfedge(v.id());
+        auto he = start;
+        do {
+            pos += beta * position[traversal.tip(he)];
+        } while ((he = traversal.next(traversal.twin(he))) != start);
+        out[v.index()] = pos;
+    }
+}
+template <typename Traversal, typename Positions>
+void edge_pass_ids(SurfaceMesh &mesh, const Traversal &traversal, const Positions &position, std::vector<vec_t> &out)
+{
+    for (auto edge : mesh.edges()) {
+        auto a = traversal.halfedge_a(edge.id());
+        auto b = traversal.halfedge_b(edge.id());
+        auto end_a = position[traversal.vertex(a)];
+        auto end_b = position[traversal.vertex(b)];
+        auto wing_a = position[traversal.vertex(traversal.next(traversal.next(a)))];
+        auto wing_b = position[traversal.vertex(traversal.next(traversal.next(b)))];
+        out[edge.index()] = (1.0/8.0)*wing_a + (1.0/8.0)*wing_b + (3.0/8.0)*end_a + (3.0/8.0)*end_b;
+    }
+}
+
+void report_pass(const std::string &name, size_t items, const std::function<void()> &pass)
+{
+    Bench::report(name, Bench::best_of(5, [&]() {
+        Bench::Timer timer;
+        pass();
+        return timer.seconds();
+    }), items);
+}
+
+} // namespace
+
+
+BENCHMARK(traversal_checks)
+{
+    std::string checks = MESH_PROCESSING_TRAVERSAL_CHECKS ? "checks=on" : "checks=off";
+    Bench::for_each_locked_input([&](const std::string &name, const Bench::TriangleData &, SurfaceGeometry &geom) {
+        SurfaceMesh &mesh = geom.mesh;
+        std::vector<vec_t> vertex_points(mesh.num_vertices());
+        std::vector<vec_t> edge_points(mesh.num_edges());
+        PositionPointer position_pointer = {geom.position.data_pointer()};
+
+        report_pass(name + "vertex pass handles " + checks, mesh.num_vertices(), [&]() {
+            vertex_pass_handles(geom, vertex_points);
+        });
+        report_pass(name + "vertex pass ids " + checks, mesh.num_vertices(), [&]() {
+            vertex_pass_ids(mesh, mesh, geom.position, vertex_points);
+        });
+        report_pass(name + "vertex pass unchecked", mesh.num_vertices(), [&]() {
+            vertex_pass_ids(mesh, mesh.unchecked(), position_pointer, vertex_points);
+        });
+        report_pass(name + "edge pass handles " + checks, mesh.num_edges(), [&]() {
+            edge_pass_handles(geom, edge_points);
+        });
+        report_pass(name + "edge pass ids " + checks, mesh.num_edges(), [&]() {
+            edge_pass_ids(mesh, mesh, geom.position, edge_points);
+        });
+        report_pass(name + "edge pass unchecked", mesh.num_edges(), [&]() {
+            edge_pass_ids(mesh, mesh.unchecked(), position_pointer, edge_points);
+        });
+    });
+}
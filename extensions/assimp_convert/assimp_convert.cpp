@@ -4,44 +4,54 @@
 
 SurfaceGeometry *assimp_to_surface_geometry(const std::string &filename)
 {
+    Trace::Scope trace("assimp_to_surface_geometry");
+    Trace::Scope phase("assimp: read file");
     Assimp::Importer importer;
     auto flags = aiProcess_DropNormals | aiProcess_JoinIdenticalVertices; // see the assimp postprocess.h header for explanation of DropNormals.
     const aiScene *scene = importer.ReadFile(filename, flags);
+    phase.next("assimp: build mesh");
     assert(scene);
     assert(scene->mNumMeshes > 0);
 
     SurfaceMesh *surface_mesh = new SurfaceMesh();
     SurfaceGeometry *geom = new SurfaceGeometry(*surface_mesh);
+    // Reserve for all of the meshes at once, so that the pools only grow once. The boundary halfedges added by lock() aren't known yet.
+    size_t num_vertices = 0;
+    size_t num_halfedges = 0;
+    size_t num_faces = 0;
+    for (int mesh_index = 0; mesh_index < scene->mNumMeshes; mesh_index++) {
+        aiMesh *mesh = scene->mMeshes[mesh_index];
+        num_vertices += mesh->mNumVertices;
+        num_faces += mesh->mNumFaces;
+        for (int face_index = 0; face_index < mesh->mNumFaces; face_index++) {
+            num_halfedges += mesh->mFaces[face_index].mNumIndices;
+        }
+    }
+    surface_mesh->reserve(num_vertices, num_halfedges, num_faces);
     for (int mesh_index = 0; mesh_index < scene->mNumMeshes; mesh_index++) {
         aiMesh *mesh = scene->mMeshes[mesh_index];
 
-        std::vector<Vertex> vertex_list(mesh->mNumVertices);
+        // Add all vertices at once. These have contiguous indices starting at first_vertex.
+        ElementIndex first_vertex = surface_mesh->add_vertices(mesh->mNumVertices);
         for (int vertex_index = 0; vertex_index < mesh->mNumVertices; vertex_index++) {
             auto &position = mesh->mVertices[vertex_index];
-            vertex_list[vertex_index] = surface_mesh->add_vertex();
-            geom->position[vertex_list[vertex_index]] = vec_t(position.x, position.y, position.z);
-        }
-        // Get maximum number of vertices in a face.
-        uint32_t max_face_vertices = 0;
-        uint32_t min_face_vertices = std::numeric_limits<uint32_t>::max();
-        for (int face_index = 0; face_index < mesh->mNumFaces; face_index++) {
-            uint32_t n = mesh->mFaces[face_index].mNumIndices;
-            max_face_vertices = std::max(max_face_vertices, n);
-            min_face_vertices = std::min(min_face_vertices, n);
+            geom->position[Vertex(*surface_mesh, first_vertex + vertex_index)] = vec_t(position.x, position.y, position.z);
         }
-        assert(max_face_vertices > 0 && min_face_vertices >= 3);
 
-        std::vector<Vertex> face_vertices(max_face_vertices);
+        // Flatten the faces into offset-encoded index arrays, and add them all at once.
+        std::vector<ElementIndex> face_offsets(mesh->mNumFaces + 1);
+        std::vector<ElementIndex> face_vertex_indices;
+        face_offsets[0] = 0;
         for (int face_index = 0; face_index < mesh->mNumFaces; face_index++) {
             aiFace *face = &mesh->mFaces[face_index];
+            assert(face->mNumIndices >= 3);
             for (uint32_t face_index_index = 0; face_index_index < face->mNumIndices; face_index_index++) {
-                uint32_t index = face->mIndices[face_index_index];
-                face_vertices[face_index_index] = vertex_list[index];
+                face_vertex_indices.push_back(first_vertex + face->mIndices[face_index_index]);
             }
-            surface_mesh->add_face(&face_vertices[0], face->mNumIndices);
+            face_offsets[face_index + 1] = face_vertex_indices.size();
         }
+        surface_mesh->add_faces(face_vertex_indices.data(), face_offsets.data(), mesh->mNumFaces);
     }
     return geom;
 }
 
-
@@ -2,8 +2,11 @@
 #define MESH_PROCESSING_ENMESH_H
 namespace Enmesh {
 
-// SurfaceMesh grid_mesh(int x_nodes, int y_nodes);
-// SurfaceGeometry grid_geom(int x_nodes, int y_nodes, float bl_x, float bl_y, float tr_x, float tr_y);
+// Build an x_nodes-by-y_nodes grid into mesh, which must be empty.
+void grid_mesh(SurfaceMesh &mesh, int x_nodes, int y_nodes);
+SurfaceMesh *grid_mesh(int x_nodes, int y_nodes); // The caller owns the returned mesh.
+// Build the grid into mesh, which must be empty and outlive the geometry. The caller owns the returned geometry.
+SurfaceGeometry *grid_geom(SurfaceMesh &mesh, int x_nodes, int y_nodes, float bl_x, float bl_y, float tr_x, float tr_y);
 
 void save_geometry(SurfaceGeometry &geom, const std::string &filename);
 // SurfaceGeometry load_geometry(const std::string &filename);
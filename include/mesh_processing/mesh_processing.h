@@ -11,6 +11,10 @@
 
 #include <Eigen/Core>
 
+// Utilities
+#include "parallel/parallel.h"
+#include "trace/trace.h"
+
 // Data structures
 #include "surface_mesh/surface_mesh.h"
 #include "surface_geometry/surface_geometry.h"
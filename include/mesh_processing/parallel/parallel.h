@@ -0,0 +1,61 @@
+#ifndef MESH_PROCESSING_PARALLEL_H
+#define MESH_PROCESSING_PARALLEL_H
+#include <functional>
+#include <vector>
+/*--------------------------------------------------------------------------------
+    Parallel
+    Data-parallel helpers used by the bulk mesh algorithms.
+    Work is split into contiguous index ranges, so that each thread touches a dense
+    block of attachment data.
+
+    The work runs on a thread pool owned by the library, which is started on first use and kept for later calls.
+    The calling thread takes part. Each thread starts with a contiguous share of the chunks of a range,
+    and threads which run out of work steal half of the remaining chunks of another thread.
+    Parallel calls made from inside a parallel call run serially on the calling thread.
+--------------------------------------------------------------------------------*/
+namespace Parallel {
+
+// The number of threads used by for_range. 0 (the default) means std::thread::hardware_concurrency().
+// The thread pool is resized on the next parallel call, so this should not be called during one.
+void set_num_threads(unsigned int num_threads);
+unsigned int num_threads();
+
+// The least number of indices given to one call of a for_range function, when no grain size is passed (default 4096).
+void set_grain_size(size_t grain_size);
+size_t grain_size();
+
+// Call function(range_begin, range_end) on disjoint subranges covering [begin, end), in parallel.
+// Ranges smaller than grain_size (or Parallel::grain_size(), if 0) are not split. The function must be safe to call
+// concurrently on disjoint ranges.
+void for_range(size_t begin, size_t end, const std::function<void(size_t, size_t)> &function, size_t grain_size = 0);
+
+// Split [begin, end) into num_chunks contiguous chunks, and call function(chunk_index, chunk_begin, chunk_end) for each, in parallel.
+// The split only depends on the arguments, so per-chunk results of one pass can be combined in chunk order
+// in a later pass (e.g. for prefix sums), giving the same result as a serial sweep.
+void for_chunks(size_t begin, size_t end, size_t num_chunks, const std::function<void(size_t, size_t, size_t)> &function);
+// A reasonable number of chunks for n elements: a few per thread, with at least grain_size elements per chunk.
+size_t default_num_chunks(size_t n, size_t grain_size = 4096);
+
+// Deterministic reduction.
+// [begin, end) is split into chunks of about grain_size indices (Parallel::grain_size(), if 0), map(chunk_begin, chunk_end)
+// gives the value of each chunk in parallel, and the values are combined in chunk order on the calling thread.
+// The split does not depend on the number of threads, so neither does the result (even for floating point sums).
+template <typename T, typename Map, typename Combine>
+T reduce(size_t begin, size_t end, const T &identity, Map map, Combine combine, size_t grain_size = 0)
+{
+    if (end <= begin) return identity;
+    size_t grain = grain_size > 0 ? grain_size : Parallel::grain_size();
+    size_t num_chunks = (end - begin + grain - 1) / grain;
+    std::vector<T> values(num_chunks, identity);
+    for_chunks(begin, end, num_chunks, [&](size_t chunk, size_t chunk_begin, size_t chunk_end) {
+        values[chunk] = map(chunk_begin, chunk_end);
+    });
+    T result = identity;
+    for (auto &value : values) {
+        result = combine(result, value);
+    }
+    return result;
+}
+
+}; // namespace Parallel
+#endif // MESH_PROCESSING_PARALLEL_H
@@ -17,9 +17,17 @@ public:
 
     inline Vertex corresponding_vertex(Vertex original_vertex)
     {
-        return m_vertex_to_vertex[original_vertex];
+        return Vertex(m_subdiv_mesh, m_vertex_to_vertex[original_vertex]);
     }
     inline Vertex edge_split_vertex(Edge original_edge)
+    {
+        return Vertex(m_subdiv_mesh, m_edge_split_vertex[original_edge]);
+    }
+    inline VertexId corresponding_vertex(VertexId original_vertex) const
+    {
+        return m_vertex_to_vertex[original_vertex];
+    }
+    inline VertexId edge_split_vertex(EdgeId original_edge) const
     {
         return m_edge_split_vertex[original_edge];
     }
@@ -28,8 +36,9 @@ private:
     SurfaceMesh *m_original_mesh;
     SurfaceMesh m_subdiv_mesh;
 
-    EdgeAttachment<Vertex> m_edge_split_vertex;
-    VertexAttachment<Vertex> m_vertex_to_vertex;
+    // Vertex ids in the subdivided mesh.
+    EdgeAttachment<VertexId> m_edge_split_vertex;
+    VertexAttachment<VertexId> m_vertex_to_vertex;
 
     friend class SurfaceMesh;
 };
@@ -0,0 +1,99 @@
+#ifndef ATTACHMENT_MAP_H
+#define ATTACHMENT_MAP_H
+/*--------------------------------------------------------------------------------
+    AttachmentMap
+    Eigen::Map views over the entries of an attachment, so that Eigen expressions can run over all elements at once
+    without copying. Entries can be scalars (one per element) or fixed-size Eigen vectors, e.g. vec_t positions,
+    which are viewed as the columns of a matrix.
+    usage:
+        // Translate every vertex.
+        AttachmentMap::for_each_block(geom.position, [&](AttachmentMap::Map<vec_t> block, ElementIndex) {
+            block.colwise() += offset;
+        });
+        // A dense pool (nothing removed) is one block, and can be viewed directly.
+        float max_x = AttachmentMap::dense(geom.position).row(0).maxCoeff();
+
+    Entries of inactive elements are unspecified, so a pool with holes is viewed as one block for each run of
+    active elements (see ElementPool::active_runs()). As with ElementAttachment::data_pointer(), views are invalidated
+    when elements are added.
+--------------------------------------------------------------------------------*/
+
+namespace AttachmentMap {
+
+// How an entry type is viewed: scalars as a column vector, and Eigen vectors of Rows scalars as a Rows-by-n matrix.
+template <typename T, typename Enable = void>
+struct Entry;
+template <typename T>
+struct Entry<T, typename std::enable_if<std::is_arithmetic<T>::value>::type> {
+    typedef T Scalar;
+    typedef Eigen::Matrix<T, Eigen::Dynamic, 1> Matrix;
+    static inline Eigen::Index rows(size_t n) { return Eigen::Index(n); }
+    static inline Eigen::Index cols(size_t) { return 1; }
+};
+template <typename EntryScalar, int Rows, int Options, int MaxRows>
+struct Entry<Eigen::Matrix<EntryScalar, Rows, 1, Options, MaxRows, 1>, typename std::enable_if<Rows != Eigen::Dynamic>::type> {
+    typedef EntryScalar Scalar;
+    typedef Eigen::Matrix<EntryScalar, Rows, Eigen::Dynamic> Matrix;
+    static inline Eigen::Index rows(size_t) { return Rows; }
+    static inline Eigen::Index cols(size_t n) { return Eigen::Index(n); }
+    static_assert(sizeof(Eigen::Matrix<EntryScalar, Rows, 1, Options, MaxRows, 1>) == Rows * sizeof(EntryScalar),
+                  "AttachmentMap: Eigen vector entries must be packed scalars.");
+};
+
+template <typename T>
+using Map = Eigen::Map<typename Entry<T>::Matrix>;
+template <typename T>
+using ConstMap = Eigen::Map<const typename Entry<T>::Matrix>;
+
+
+// A view of the n entries from first_index.
+template <typename T>
+inline Map<T> block(ElementAttachment<T> &attachment, ElementIndex first_index, size_t n)
+{
+    auto scalars = reinterpret_cast<typename Entry<T>::Scalar *>(attachment.data_pointer() + first_index);
+    return Map<T>(scalars, Entry<T>::rows(n), Entry<T>::cols(n));
+}
+template <typename T>
+inline ConstMap<T> block(const ElementAttachment<T> &attachment, ElementIndex first_index, size_t n)
+{
+    auto scalars = reinterpret_cast<const typename Entry<T>::Scalar *>(attachment.data_pointer() + first_index);
+    return ConstMap<T>(scalars, Entry<T>::rows(n), Entry<T>::cols(n));
+}
+
+// A view of all entries of an attachment whose pool is dense (see ElementPool::dense()), in element index order.
+// This is the fast path, with no per-run overhead.
+template <typename T>
+inline Map<T> dense(ElementAttachment<T> &attachment)
+{
+    RawAttachmentView view = attachment.raw_view();
+    assert(view.dense);
+    return block(attachment, 0, view.end_index);
+}
+template <typename T>
+inline ConstMap<T> dense(const ElementAttachment<T> &attachment)
+{
+    RawAttachmentView view = attachment.raw_view();
+    assert(view.dense);
+    return block(attachment, 0, view.end_index);
+}
+
+// Call f(block, first_index) for each run of active elements, in index order, where block is a view of the entries
+// of the run. A dense pool is a single call.
+template <typename T, typename F>
+void for_each_block(ElementAttachment<T> &attachment, F f)
+{
+    for (auto run : attachment.raw_view().pool->active_runs()) {
+        f(block(attachment, run.first, run.second), run.first);
+    }
+}
+template <typename T, typename F>
+void for_each_block(const ElementAttachment<T> &attachment, F f)
+{
+    for (auto run : attachment.raw_view().pool->active_runs()) {
+        f(block(attachment, run.first, run.second), run.first);
+    }
+}
+
+} // namespace AttachmentMap
+
+#endif // ATTACHMENT_MAP_H
@@ -1,8 +1,15 @@
 #ifndef SURFACE_GEOMETRY_H
 #define SURFACE_GEOMETRY_H
+#include <Eigen/Geometry>
 
 class CompactTriangleMesh;
 using vec_t = Eigen::Vector3f;
+// Fixed-size Eigen matrices of trivial scalars have non-trivial copy constructors, but are trivial as attachment entries.
+template <typename Scalar, int Rows, int Cols, int Options, int MaxRows, int MaxCols>
+struct TrivialAttachmentEntry<Eigen::Matrix<Scalar, Rows, Cols, Options, MaxRows, MaxCols>> :
+    std::integral_constant<bool, Rows != Eigen::Dynamic && Cols != Eigen::Dynamic && std::is_trivially_copyable<Scalar>::value> {};
+
+#include "mesh_processing/surface_geometry/attachment_map.h"
 
 class SurfaceGeometry {
 public:
@@ -13,6 +20,13 @@ public:
         mesh{_mesh},
         position(mesh)
     {}
+    // Copy the geometry of another mesh onto a copy of it (see SurfaceMesh(const SurfaceMesh &)).
+    SurfaceGeometry(SurfaceMesh &_mesh, const SurfaceGeometry &other) :
+        mesh{_mesh},
+        position(mesh)
+    {
+        position.copy(other.position);
+    }
 
     // Geometry helpers.
     float triangle_area(Face tri) const;
@@ -22,9 +36,25 @@ public:
     vec_t midpoint(Edge edge) const;
     vec_t vector(Halfedge he) const;
 
+    // Whole-mesh geometry. These run as Eigen expressions over the positions (see AttachmentMap), with one
+    // expression for a mesh with no removed vertices.
+    // The bounding box is (min, max). For an empty mesh, min is +infinity and max is -infinity.
+    std::pair<vec_t, vec_t> bounding_box() const;
+    vec_t centroid() const; // The mean of the vertex positions. For an empty mesh, this is zero.
+    void transform(const Eigen::Affine3f &transformation);
+
+    // Bulk construction. Add vertices with the given positions (x, y, z for each vertex), returning the index
+    // of the first. The new vertices have contiguous indices (see SurfaceMesh::add_vertices), and faces can
+    // then be added with SurfaceMesh::add_faces.
+    ElementIndex add_vertices(const float *positions, size_t num_vertices);
+
+    // Reorder the mesh elements for cache locality of traversals. The vertices are sorted along a Morton (Z-order) curve
+    // through their positions, and the other elements follow (see SurfaceMesh::reorder()). Returns the old-to-new index maps.
+    SurfaceMesh::ElementIndexMaps spatial_reorder();
+
     // Convert from a simple list of vertex positions and triangle indices.
-    // This creates the underlying mesh then attaches geometry positions.
-    // SurfaceGeometry(CompactTriangleMesh &tris);
+    // This adds the triangles to the underlying mesh (which is left unlocked) then attaches geometry positions.
+    SurfaceGeometry(SurfaceMesh &_mesh, const CompactTriangleMesh &tris);
 };
 
 #endif // SURFACE_GEOMETRY_H
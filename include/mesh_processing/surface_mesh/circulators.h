@@ -0,0 +1,246 @@
+#ifndef SURFACE_MESH_CIRCULATORS_H
+#define SURFACE_MESH_CIRCULATORS_H
+/*--------------------------------------------------------------------------------
+    Circulators
+    Ranges over the cycle of halfedges around a vertex or a face, for range-based for loops.
+    usage:
+        for (auto he : vertex.outgoing_halfedges()) { ... }
+        for (auto v : face.vertices()) { ... }
+
+    A circulator starts at a halfedge and steps (e.g. he -> he.twin().next()) until it is back at the start,
+    giving an element for each halfedge on the way (e.g. the tip, for the one-ring). This is the usual
+        auto he = start;
+        do { ... } while ((he = he.twin().next()) != start);
+    loop on raw indices, and there are no checks per step.
+    Circulators of a SurfaceMesh (made from handles) give handles. Circulators of an UncheckedTraversal give ids.
+
+    Vertex circulators are only valid when the mesh is locked. A boundary vertex's halfedge is the first after the
+    boundary (see lock()), so vertex circulators go from the first face around to the boundary.
+--------------------------------------------------------------------------------*/
+
+namespace Circulation {
+
+// Each circulation gives the step from one halfedge to the next, the element given for each halfedge,
+// and a condition for stopping early.
+struct OutgoingHalfedges {
+    typedef HalfedgeId element_type;
+    template <typename Traversal> static inline HalfedgeId step(const Traversal &t, HalfedgeId he) { return t.next(t.twin(he)); }
+    template <typename Traversal> static inline HalfedgeId element(const Traversal &, HalfedgeId he) { return he; }
+    template <typename Traversal> static inline bool stop(const Traversal &, HalfedgeId) { return false; }
+};
+struct IncomingHalfedges {
+    typedef HalfedgeId element_type;
+    template <typename Traversal> static inline HalfedgeId step(const Traversal &t, HalfedgeId he) { return t.next(t.twin(he)); }
+    template <typename Traversal> static inline HalfedgeId element(const Traversal &t, HalfedgeId he) { return t.twin(he); }
+    template <typename Traversal> static inline bool stop(const Traversal &, HalfedgeId) { return false; }
+};
+// The vertices adjacent to a vertex.
+struct OneRing {
+    typedef VertexId element_type;
+    template <typename Traversal> static inline HalfedgeId step(const Traversal &t, HalfedgeId he) { return t.next(t.twin(he)); }
+    template <typename Traversal> static inline VertexId element(const Traversal &t, HalfedgeId he) { return t.vertex(t.twin(he)); }
+    template <typename Traversal> static inline bool stop(const Traversal &, HalfedgeId) { return false; }
+};
+// The faces incident to a vertex. At a boundary vertex, the last outgoing halfedge is on the boundary and has no face.
+struct Fan {
+    typedef FaceId element_type;
+    template <typename Traversal> static inline HalfedgeId step(const Traversal &t, HalfedgeId he) { return t.next(t.twin(he)); }
+    template <typename Traversal> static inline FaceId element(const Traversal &t, HalfedgeId he) { return t.face(he); }
+    template <typename Traversal> static inline bool stop(const Traversal &t, HalfedgeId he) { return t.face(he).null(); }
+};
+// The halfedges of a face (or a boundary loop).
+struct HalfedgeLoop {
+    typedef HalfedgeId element_type;
+    template <typename Traversal> static inline HalfedgeId step(const Traversal &t, HalfedgeId he) { return t.next(he); }
+    template <typename Traversal> static inline HalfedgeId element(const Traversal &, HalfedgeId he) { return he; }
+    template <typename Traversal> static inline bool stop(const Traversal &, HalfedgeId) { return false; }
+};
+// The vertices of a face (or a boundary loop).
+struct LoopVertices {
+    typedef VertexId element_type;
+    template <typename Traversal> static inline HalfedgeId step(const Traversal &t, HalfedgeId he) { return t.next(he); }
+    template <typename Traversal> static inline VertexId element(const Traversal &t, HalfedgeId he) { return t.vertex(he); }
+    template <typename Traversal> static inline bool stop(const Traversal &, HalfedgeId) { return false; }
+};
+
+// The value given by a circulator for an element id: the handle for a SurfaceMesh, and the id itself otherwise.
+template <typename Traversal, typename Id>
+struct Value {
+    typedef Id type;
+    static inline Id make(Traversal &, Id id) { return id; }
+};
+template <> struct Value<SurfaceMesh, VertexId> {
+    typedef Vertex type;
+    static inline Vertex make(SurfaceMesh &mesh, VertexId id) { return Vertex(mesh, id); }
+};
+template <> struct Value<SurfaceMesh, HalfedgeId> {
+    typedef Halfedge type;
+    static inline Halfedge make(SurfaceMesh &mesh, HalfedgeId id) { return Halfedge(mesh, id); }
+};
+template <> struct Value<SurfaceMesh, FaceId> {
+    typedef Face type;
+    static inline Face make(SurfaceMesh &mesh, FaceId id) { return Face(mesh, id); }
+};
+
+// How circulators refer to their traversal. A SurfaceMesh is referred to by pointer. An UncheckedTraversal is only
+// a few pointers, and is copied, so that circulators made from a temporary UncheckedTraversal stay valid.
+template <typename Traversal>
+struct TraversalReference {
+    TraversalReference(Traversal &_traversal) : traversal(_traversal) {}
+    inline Traversal &get() const { return traversal; }
+    typename std::remove_const<Traversal>::type traversal;
+};
+template <> struct TraversalReference<SurfaceMesh> {
+    TraversalReference(SurfaceMesh &_mesh) : mesh{&_mesh} {}
+    inline SurfaceMesh &get() const { return *mesh; }
+    SurfaceMesh *mesh;
+};
+
+} // namespace Circulation
+
+
+template <typename Traversal, typename Circulation>
+class HalfedgeCirculator {
+public:
+    typedef typename Circulation::element_type element_type;
+    typedef typename ::Circulation::Value<Traversal, element_type> value_maker;
+    typedef typename value_maker::type value_type;
+
+    // A null halfedge gives the end iterator.
+    HalfedgeCirculator(const ::Circulation::TraversalReference<Traversal> &_traversal, HalfedgeId _start, HalfedgeId _halfedge) :
+        traversal(_traversal), start{_start}, halfedge{_halfedge}
+    {}
+
+    inline value_type operator*() const {
+        return value_maker::make(traversal.get(), Circulation::element(traversal.get(), halfedge));
+    }
+    inline HalfedgeCirculator &operator++() {
+        HalfedgeId he = Circulation::step(traversal.get(), halfedge);
+        halfedge = (he == start || Circulation::stop(traversal.get(), he)) ? HalfedgeId() : he;
+        return *this;
+    }
+    inline bool operator==(const HalfedgeCirculator &other) const { return halfedge == other.halfedge; }
+    inline bool operator!=(const HalfedgeCirculator &other) const { return halfedge != other.halfedge; }
+private:
+    ::Circulation::TraversalReference<Traversal> traversal;
+    HalfedgeId start;
+    HalfedgeId halfedge; // Null at the end.
+};
+
+
+template <typename Traversal, typename Circulation>
+class CirculatorRange {
+public:
+    typedef HalfedgeCirculator<Traversal, Circulation> iterator;
+
+    // Circulate from the start halfedge. A null start gives an empty range.
+    CirculatorRange(Traversal &_traversal, HalfedgeId _start) :
+        traversal(_traversal), start{_start}
+    {}
+    inline iterator begin() const { return iterator(traversal, start, start); }
+    inline iterator end() const { return iterator(traversal, start, HalfedgeId()); }
+private:
+    ::Circulation::TraversalReference<Traversal> traversal;
+    HalfedgeId start;
+};
+
+
+/*--------------------------------------------------------------------------------
+    Element handle circulators.
+--------------------------------------------------------------------------------*/
+inline OutgoingHalfedgeRange Vertex::outgoing_halfedges() const
+{
+    return OutgoingHalfedgeRange(*mesh, mesh->halfedge(id()));
+}
+inline IncomingHalfedgeRange Vertex::incoming_halfedges() const
+{
+    return IncomingHalfedgeRange(*mesh, mesh->halfedge(id()));
+}
+inline OneRingRange Vertex::one_ring() const
+{
+    return OneRingRange(*mesh, mesh->halfedge(id()));
+}
+inline FanRange Vertex::fan() const
+{
+    return FanRange(*mesh, mesh->halfedge(id()));
+}
+
+inline HalfedgeLoopRange Halfedge::loop() const
+{
+    return HalfedgeLoopRange(*mesh, id());
+}
+inline LoopVerticesRange Halfedge::loop_vertices() const
+{
+    return LoopVerticesRange(*mesh, id());
+}
+
+inline HalfedgeLoopRange Face::halfedges() const
+{
+    return HalfedgeLoopRange(*mesh, mesh->halfedge(id()));
+}
+inline LoopVerticesRange Face::vertices() const
+{
+    return LoopVerticesRange(*mesh, mesh->halfedge(id()));
+}
+inline std::array<Halfedge, 3> Face::triangle_halfedges() const
+{
+    HalfedgeId a = mesh->halfedge(id());
+    HalfedgeId b = mesh->next(a);
+    HalfedgeId c = mesh->next(b);
+#if MESH_PROCESSING_TRAVERSAL_CHECKS
+    assert(mesh->next(c) == a);
+#endif
+    return {{Halfedge(*mesh, a), Halfedge(*mesh, b), Halfedge(*mesh, c)}};
+}
+inline std::array<Vertex, 3> Face::triangle_vertices() const
+{
+    HalfedgeId a = mesh->halfedge(id());
+    HalfedgeId b = mesh->next(a);
+    HalfedgeId c = mesh->next(b);
+#if MESH_PROCESSING_TRAVERSAL_CHECKS
+    assert(mesh->next(c) == a);
+#endif
+    return {{Vertex(*mesh, mesh->vertex(a)), Vertex(*mesh, mesh->vertex(b)), Vertex(*mesh, mesh->vertex(c))}};
+}
+
+
+/*--------------------------------------------------------------------------------
+    UncheckedTraversal circulators.
+--------------------------------------------------------------------------------*/
+inline UncheckedTraversal::OutgoingHalfedgeRange UncheckedTraversal::outgoing_halfedges(VertexId vertex) const
+{
+    return OutgoingHalfedgeRange(*this, halfedge(vertex));
+}
+inline UncheckedTraversal::IncomingHalfedgeRange UncheckedTraversal::incoming_halfedges(VertexId vertex) const
+{
+    return IncomingHalfedgeRange(*this, halfedge(vertex));
+}
+inline UncheckedTraversal::OneRingRange UncheckedTraversal::one_ring(VertexId vertex) const
+{
+    return OneRingRange(*this, halfedge(vertex));
+}
+inline UncheckedTraversal::FanRange UncheckedTraversal::fan(VertexId vertex) const
+{
+    return FanRange(*this, halfedge(vertex));
+}
+inline UncheckedTraversal::HalfedgeLoopRange UncheckedTraversal::loop(HalfedgeId start) const
+{
+    return HalfedgeLoopRange(*this, start);
+}
+inline UncheckedTraversal::HalfedgeLoopRange UncheckedTraversal::face_halfedges(FaceId face) const
+{
+    return HalfedgeLoopRange(*this, halfedge(face));
+}
+inline UncheckedTraversal::LoopVerticesRange UncheckedTraversal::face_vertices(FaceId face) const
+{
+    return LoopVerticesRange(*this, halfedge(face));
+}
+inline std::array<VertexId, 3> UncheckedTraversal::triangle_vertices(FaceId face) const
+{
+    HalfedgeId a = halfedge(face);
+    HalfedgeId b = next(a);
+    HalfedgeId c = next(b);
+    return {{vertex(a), vertex(b), vertex(c)}};
+}
+
+#endif // SURFACE_MESH_CIRCULATORS_H
@@ -0,0 +1,266 @@
+#ifndef SURFACE_MESH_SNAPSHOT_H
+#define SURFACE_MESH_SNAPSHOT_H
+#include <memory>
+/*--------------------------------------------------------------------------------
+    Mesh snapshots
+    Immutable, versioned views of a SurfaceMesh (and chosen attachments) for reader threads, while a writer thread edits the mesh.
+    usage:
+        // Writer thread.
+        MeshVersions versions(mesh);
+        auto position = versions.track(geom.position);
+        versions.publish();
+        ... edit the mesh ...
+        versions.publish();
+
+        // Reader threads.
+        auto snapshot = versions.snapshot();
+        for (auto face : snapshot->faces()) {
+            for (auto v : snapshot->face_vertices(face)) total += snapshot->get(position, v);
+        }
+
+    A snapshot stores each array of element data (the incidences, the active flags of the pools, and the tracked attachments)
+    as reference-counted chunks of 4096 entries. publish() compares each chunk with the last snapshot, and only copies the
+    chunks which have changed, sharing the rest. So after a local edit, publishing copies a few chunks, and consecutive
+    snapshots share almost all of their memory. Getting the latest snapshot is O(1), and a reader can keep using it for as
+    long as it holds it, whatever the writer does.
+
+    Snapshots have the index-based traversal methods of UncheckedTraversal (and its circulators), so kernels templated on
+    the traversal run on them. The halfedge map is not included, so halfedges can't be looked up by vertex pair.
+--------------------------------------------------------------------------------*/
+
+// An array of fixed-size entries, stored in shared immutable chunks.
+class ChunkedArray {
+public:
+    static constexpr unsigned int chunk_shift = 12;
+    static constexpr size_t chunk_entries = size_t(1) << chunk_shift;
+    typedef std::shared_ptr<const std::vector<uint8_t>> Chunk;
+
+    ChunkedArray() : entry_size{0}, num_entries{0} {}
+
+    inline const uint8_t *entry(size_t i) const {
+        return chunks[i >> chunk_shift]->data() + (i & (chunk_entries - 1)) * entry_size;
+    }
+    // Read bit i, for an array of 64-bit words.
+    inline bool bit(size_t i) const {
+        return (*reinterpret_cast<const uint64_t *>(entry(i >> 6)) >> (i & 63)) & 1;
+    }
+
+    // Set the contents to a copy of num_entries entries at data. Chunks which are the same in previous are shared with it.
+    // Returns the number of bytes copied.
+    size_t update(const uint8_t *data, size_t entry_size, size_t num_entries, const ChunkedArray *previous);
+
+    size_t entry_size;
+    size_t num_entries;
+    std::vector<Chunk> chunks;
+};
+
+
+// A key for the snapshots of an attachment tracked by MeshVersions::track().
+template <typename T>
+struct SnapshotAttachment {
+    size_t array_index;
+};
+
+
+template <typename Id>
+class SnapshotElementRange {
+public:
+    class iterator {
+    public:
+        iterator(const ChunkedArray *_active_words, ElementIndex _index, ElementIndex _end) :
+            active_words{_active_words}, index{_index}, end{_end}
+        {
+            while (index < end && !active_words->bit(index)) index++;
+        }
+        inline Id operator*() const { return Id(index); }
+        inline iterator &operator++() {
+            do { index++; } while (index < end && !active_words->bit(index));
+            return *this;
+        }
+        inline bool operator==(const iterator &other) const { return index == other.index; }
+        inline bool operator!=(const iterator &other) const { return index != other.index; }
+    private:
+        const ChunkedArray *active_words;
+        ElementIndex index;
+        ElementIndex end;
+    };
+    SnapshotElementRange(const ChunkedArray *_active_words, ElementIndex _end) :
+        active_words{_active_words}, end_index{_end}
+    {}
+    inline iterator begin() const { return iterator(active_words, 0, end_index); }
+    inline iterator end() const { return iterator(active_words, end_index, end_index); }
+private:
+    const ChunkedArray *active_words;
+    ElementIndex end_index;
+};
+
+
+class MeshSnapshot;
+// Circulators refer to a snapshot by pointer.
+namespace Circulation {
+template <> struct TraversalReference<const MeshSnapshot> {
+    TraversalReference(const MeshSnapshot &_snapshot) : snapshot{&_snapshot} {}
+    inline const MeshSnapshot &get() const { return *snapshot; }
+    const MeshSnapshot *snapshot;
+};
+} // namespace Circulation
+
+
+class MeshSnapshot {
+public:
+    // The number of snapshots published before this one.
+    inline uint64_t version() const { return m_version; }
+
+    // Topology, as when the snapshot was published.
+    inline bool locked() const { return m_locked; }
+    inline size_t num_vertices() const { return pools[VertexPool].num_elements; }
+    inline size_t num_halfedges() const { return pools[HalfedgePool].num_elements; }
+    inline size_t num_edges() const { return pools[EdgePool].num_elements; }
+    inline size_t num_faces() const { return pools[FacePool].num_elements; }
+    inline size_t num_interior_vertices() const { return m_num_interior_vertices; }
+    inline size_t num_interior_edges() const { return m_num_interior_edges; }
+    inline const std::vector<HalfedgeId> &boundary_loops() const { return m_boundary_loops; }
+
+    // Elements.
+    inline bool is_active(VertexId vertex) const { return is_active(VertexPool, vertex.index()); }
+    inline bool is_active(HalfedgeId halfedge) const { return is_active(HalfedgePool, halfedge.index()); }
+    inline bool is_active(EdgeId edge) const { return is_active(EdgePool, edge.index()); }
+    inline bool is_active(FaceId face) const { return is_active(FacePool, face.index()); }
+    inline SnapshotElementRange<VertexId> vertices() const { return element_range<VertexId>(VertexPool); }
+    inline SnapshotElementRange<HalfedgeId> halfedges() const { return element_range<HalfedgeId>(HalfedgePool); }
+    inline SnapshotElementRange<EdgeId> edges() const { return element_range<EdgeId>(EdgePool); }
+    inline SnapshotElementRange<FaceId> faces() const { return element_range<FaceId>(FacePool); }
+
+    // Index-based traversal (see UncheckedTraversal). The vertex and edge traversals are only valid if the mesh was locked.
+    inline HalfedgeId next(HalfedgeId halfedge) const { return HalfedgeId(halfedge_field(NextField, halfedge.index())); }
+    inline HalfedgeId twin(HalfedgeId halfedge) const { return HalfedgeId(halfedge_field(TwinField, halfedge.index())); }
+    inline VertexId vertex(HalfedgeId halfedge) const { return VertexId(halfedge_field(VertexField, halfedge.index())); }
+    inline VertexId tip(HalfedgeId halfedge) const { return vertex(next(halfedge)); }
+    inline FaceId face(HalfedgeId halfedge) const { return FaceId(halfedge_field(FaceField, halfedge.index())); }
+    inline EdgeId edge(HalfedgeId halfedge) const { return EdgeId(halfedge_field(EdgeField, halfedge.index())); }
+    inline HalfedgeId halfedge(VertexId vertex) const {
+        return HalfedgeId(reinterpret_cast<const VertexIncidenceData *>(vertex_incidence.entry(vertex.index()))->halfedge_index);
+    }
+    inline HalfedgeId halfedge(FaceId face) const {
+        return HalfedgeId(reinterpret_cast<const FaceIncidenceData *>(face_incidence.entry(face.index()))->halfedge_index);
+    }
+    inline HalfedgeId halfedge_a(EdgeId edge) const {
+        return HalfedgeId(reinterpret_cast<const EdgeIncidenceData *>(edge_incidence.entry(edge.index()))->halfedge_indices[0]);
+    }
+    inline HalfedgeId halfedge_b(EdgeId edge) const {
+        return HalfedgeId(reinterpret_cast<const EdgeIncidenceData *>(edge_incidence.entry(edge.index()))->halfedge_indices[1]);
+    }
+    inline bool on_boundary(VertexId vertex) const { return *vertex_on_boundary.entry(vertex.index()) != 0; }
+    inline bool on_boundary(EdgeId edge) const {
+        return face(halfedge_a(edge)).null() || face(halfedge_b(edge)).null();
+    }
+    inline size_t num_adjacent_vertices(VertexId vertex) const {
+        auto start = halfedge(vertex);
+        auto he = start;
+        size_t n = 0;
+        do {
+            n++;
+        } while ((he = next(twin(he))) != start);
+        return n;
+    }
+
+    // Circulators (see circulators.h), giving ids.
+    typedef CirculatorRange<const MeshSnapshot, Circulation::OutgoingHalfedges> OutgoingHalfedgeRange;
+    typedef CirculatorRange<const MeshSnapshot, Circulation::OneRing> OneRingRange;
+    typedef CirculatorRange<const MeshSnapshot, Circulation::Fan> FanRange;
+    typedef CirculatorRange<const MeshSnapshot, Circulation::HalfedgeLoop> HalfedgeLoopRange;
+    typedef CirculatorRange<const MeshSnapshot, Circulation::LoopVertices> LoopVerticesRange;
+    inline OutgoingHalfedgeRange outgoing_halfedges(VertexId vertex) const { return OutgoingHalfedgeRange(*this, halfedge(vertex)); }
+    inline OneRingRange one_ring(VertexId vertex) const { return OneRingRange(*this, halfedge(vertex)); }
+    inline FanRange fan(VertexId vertex) const { return FanRange(*this, halfedge(vertex)); }
+    inline HalfedgeLoopRange loop(HalfedgeId start) const { return HalfedgeLoopRange(*this, start); }
+    inline HalfedgeLoopRange face_halfedges(FaceId face) const { return HalfedgeLoopRange(*this, halfedge(face)); }
+    inline LoopVerticesRange face_vertices(FaceId face) const { return LoopVerticesRange(*this, halfedge(face)); }
+
+    // The entry of a tracked attachment.
+    template <typename T, typename Id>
+    inline const T &get(SnapshotAttachment<T> attachment, Id id) const {
+        return *reinterpret_cast<const T *>(attachments[attachment.array_index].entry(id.index()));
+    }
+
+private:
+    enum PoolIndex { VertexPool, HalfedgePool, EdgePool, FacePool, NumPools };
+    enum HalfedgeField { NextField, VertexField, FaceField, TwinField, EdgeField, NumHalfedgeFields };
+    struct Pool {
+        ChunkedArray active_words;
+        ElementIndex end_index;
+        size_t num_elements;
+    };
+    Pool pools[NumPools];
+    ChunkedArray vertex_incidence;
+    ChunkedArray edge_incidence;
+    ChunkedArray face_incidence;
+    ChunkedArray vertex_on_boundary;
+    // The halfedge incidence attachments (one or several, depending on the layout), and where each relation is in them.
+    std::vector<ChunkedArray> halfedge_incidence;
+    struct FieldLocation {
+        size_t array_index;
+        size_t offset;
+    };
+    FieldLocation halfedge_fields[NumHalfedgeFields];
+    std::vector<ChunkedArray> attachments;
+
+    uint64_t m_version;
+    bool m_locked;
+    size_t m_num_interior_vertices;
+    size_t m_num_interior_edges;
+    std::vector<HalfedgeId> m_boundary_loops;
+
+    inline bool is_active(PoolIndex pool, ElementIndex index) const {
+        return index < pools[pool].end_index && pools[pool].active_words.bit(index);
+    }
+    template <typename Id>
+    inline SnapshotElementRange<Id> element_range(PoolIndex pool) const {
+        return SnapshotElementRange<Id>(&pools[pool].active_words, pools[pool].end_index);
+    }
+    inline ElementIndex halfedge_field(HalfedgeField field, ElementIndex index) const {
+        const FieldLocation &location = halfedge_fields[field];
+        return *reinterpret_cast<const ElementIndex *>(halfedge_incidence[location.array_index].entry(index) + location.offset);
+    }
+
+    friend class MeshVersions;
+};
+
+
+class MeshVersions {
+public:
+    MeshVersions(SurfaceMesh &mesh);
+
+    // Include an attachment of the mesh in the snapshots published after this. The entries are copied bytewise, so T must be
+    // plain data which is valid to memcpy (such as ids, numbers, or fixed-size Eigen vectors). The attachment must outlive the MeshVersions.
+    template <typename T>
+    SnapshotAttachment<T> track(ElementAttachment<T> &attachment);
+
+    // Writer thread: publish a snapshot of the current state of the mesh. Only the chunks which have changed since the
+    // last snapshot are copied. Returns the number of bytes copied.
+    size_t publish();
+    // Reader threads: the most recently published snapshot (or null if there is none). This is O(1), and safe to call
+    // concurrently with publish().
+    std::shared_ptr<const MeshSnapshot> snapshot() const;
+
+private:
+    SurfaceMesh &mesh;
+    struct TrackedAttachment {
+        const ElementAttachmentBase *attachment;
+        const ElementPool *pool;
+    };
+    std::vector<TrackedAttachment> tracked;
+    std::shared_ptr<const MeshSnapshot> m_snapshot;
+
+    size_t update(ChunkedArray &array, const ElementAttachmentBase &attachment, const ElementPool &pool, const ChunkedArray *previous);
+};
+
+template <typename T>
+SnapshotAttachment<T> MeshVersions::track(ElementAttachment<T> &attachment)
+{
+    static_assert(std::is_trivially_destructible<T>::value, "Snapshot attachments must be plain data.");
+    tracked.push_back({&attachment, &attachment.pool});
+    return SnapshotAttachment<T>{tracked.size() - 1};
+}
+
+#endif // SURFACE_MESH_SNAPSHOT_H
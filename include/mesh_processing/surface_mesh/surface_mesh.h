@@ -1,14 +1,38 @@
 #ifndef SURFACE_MESH_H
 #define SURFACE_MESH_H
 #include <utility>
-#include <map>
+#include <array>
+#include <type_traits>
+#include <typeindex>
+#include <functional>
+#include <string>
+#include <memory>
+#include <mutex>
+#include <algorithm>
+#include <string.h>
+#include <stdlib.h>
+#include <new>
+#include <stddef.h>
 #include <assert.h>
 
 
+// Traversal checks.
+// By default, traversals check that they are valid for the state of the mesh (e.g. vertex->halfedge traversal needs a
+// locked mesh), and attachment accesses assert that the element is active. These checks are compiled out of production
+// (NDEBUG) builds, or of any build which defines MESH_PROCESSING_UNCHECKED_TRAVERSAL. Defining MESH_PROCESSING_CHECKED_TRAVERSAL
+// keeps them in an NDEBUG build. For unchecked traversal within a single scope, see SurfaceMesh::unchecked().
+#if !defined(MESH_PROCESSING_CHECKED_TRAVERSAL) && (defined(NDEBUG) || defined(MESH_PROCESSING_UNCHECKED_TRAVERSAL))
+#define MESH_PROCESSING_TRAVERSAL_CHECKS 0
+#else
+#define MESH_PROCESSING_TRAVERSAL_CHECKS 1
+#endif
+
 // typedefs
 typedef uint32_t ElementIndex;
 constexpr ElementIndex InvalidElementIndex = std::numeric_limits<ElementIndex>::max();
 
+#include "mesh_processing/surface_mesh/vertex_pair_map.h"
+
 // forward declarations
 class SurfaceMesh;
 class ElementPool;
@@ -20,22 +44,80 @@ class Edge;
 class Face;
 
 
+/*--------------------------------------------------------------------------------
+    Element ids
+    A typed element index. Unlike a handle (Vertex, Halfedge, ...), an id does not carry a reference to its mesh,
+    so it is 4 bytes, and arrays and attachments of ids are compact. Ids are used with the index-based traversal
+    methods of SurfaceMesh (e.g. mesh.next(h)), and can index attachments directly.
+--------------------------------------------------------------------------------*/
+template <typename T>
+class ElementId {
+public:
+    constexpr ElementId() : m_index{InvalidElementIndex} {}
+    constexpr explicit ElementId(ElementIndex _index) : m_index{_index} {}
+
+    inline ElementIndex index() const { return m_index; }
+    inline bool null() const { return m_index == InvalidElementIndex; }
+
+    inline bool operator==(ElementId other) const { return m_index == other.m_index; }
+    inline bool operator!=(ElementId other) const { return m_index != other.m_index; }
+    inline bool operator<(ElementId other) const { return m_index < other.m_index; }
+private:
+    ElementIndex m_index;
+};
+typedef ElementId<Vertex> VertexId;
+typedef ElementId<Halfedge> HalfedgeId;
+typedef ElementId<Edge> EdgeId;
+typedef ElementId<Face> FaceId;
+
+
+// Circulators (see circulators.h).
+class UncheckedTraversal;
+template <typename Traversal, typename Circulation> class CirculatorRange;
+namespace Circulation {
+    struct OutgoingHalfedges;
+    struct IncomingHalfedges;
+    struct OneRing;
+    struct Fan;
+    struct HalfedgeLoop;
+    struct LoopVertices;
+}
+typedef CirculatorRange<SurfaceMesh, Circulation::OutgoingHalfedges> OutgoingHalfedgeRange;
+typedef CirculatorRange<SurfaceMesh, Circulation::IncomingHalfedges> IncomingHalfedgeRange;
+typedef CirculatorRange<SurfaceMesh, Circulation::OneRing> OneRingRange;
+typedef CirculatorRange<SurfaceMesh, Circulation::Fan> FanRange;
+typedef CirculatorRange<SurfaceMesh, Circulation::HalfedgeLoop> HalfedgeLoopRange;
+typedef CirculatorRange<SurfaceMesh, Circulation::LoopVertices> LoopVerticesRange;
+
+
 /*--------------------------------------------------------------------------------
     ElementPool
 --------------------------------------------------------------------------------*/
 
+// Iterates over the active element indices of an ElementPool.
+// If the pool has no holes (nothing has been removed, which is the usual case after import), every index in [0, end)
+// is active and iteration is a plain counted loop. Otherwise, whole 64-bit words of inactive flags are skipped.
+// The end is fixed when the iterator is created, so elements added past it during iteration are not visited
+// (removed slots reused by add() may be). Elements removed during iteration are not visited: each step checks
+// whether the pool is still dense, and moves to skipping inactive elements if it is not. The pool must not be cleared,
+// permuted or shrunk during iteration.
 class ElementPoolIterator {
 public:
-    ElementPoolIterator(ElementPool *_element_pool = nullptr, ElementIndex _element_index = InvalidElementIndex);
-
-    ElementIndex operator*() const;
-    ElementPoolIterator &operator++();
-    bool operator==(const ElementPoolIterator &other) const;
-    bool operator!=(const ElementPoolIterator &other) const;
+    ElementPoolIterator(const ElementPool *_element_pool = nullptr, ElementIndex _element_index = InvalidElementIndex);
+
+    inline ElementIndex operator*() const { return element_index; }
+    inline ElementPoolIterator &operator++();
+    // Equality/inequality assumes that the element pools are the same,
+    // which is probably reasonable.
+    inline bool operator==(const ElementPoolIterator &other) const { return element_index == other.element_index; }
+    inline bool operator!=(const ElementPoolIterator &other) const { return !operator==(other); }
 private:
-    ElementPool *element_pool;
+    const ElementPool *element_pool;
     ElementIndex element_index;
-    size_t n;
+    ElementIndex end_index; // The end iterator has element_index == end_index.
+    bool dense;             // Cleared when an element is removed during iteration.
+
+    ElementIndex next_active(ElementIndex from) const;
 };
 
 
@@ -43,31 +125,153 @@ class ElementPool {
 public:
     ElementPool(size_t capacity = 1);
 
-    size_t capacity() const;
+    inline size_t capacity() const { return m_capacity; }
     ElementIndex add();
+    // Add n elements with contiguous indices, growing the pool at most once, and return the first index.
+    // These are always new indices past end_index(), so removed slots on the free-list are not reused.
+    // Each attachment initializes the whole range with one call.
+    ElementIndex add_n(size_t n);
+    // Grow the pool (and all attachments) once so that it can hold at least capacity elements.
+    void reserve(size_t capacity);
+    // The number of removed slots which add() will reuse before allocating new indices.
+    inline size_t num_free_slots() const { return m_free_list.size(); }
     void remove(ElementIndex element_index);
+    // Remove all elements. The capacity is kept, and indices are allocated from 0 again.
+    void clear();
+    // Permute the pool so that new element i is old element new_to_old[i], and move all attachment data with the elements.
+    // new_to_old must list every active element exactly once. Afterwards the elements are contiguous from 0, and the capacity
+    // is new_capacity (which must be at least num_elements()).
+    void permute(const std::vector<ElementIndex> &new_to_old, size_t new_capacity);
+    // Move the active elements to indices [0, num_elements()), keeping their order (see permute()).
+    // Returns the map from old indices to new indices, which is InvalidElementIndex for inactive slots.
+    std::vector<ElementIndex> compact(bool shrink_to_fit);
+    // Copy the elements of another pool (the active flags, free-list and capacity), so that the indices are the same.
+    // This pool's attachments are resized to the new capacity, but their entries are not copied (see ElementAttachment::copy()).
+    void copy(const ElementPool &other);
 
     inline bool is_active(ElementIndex element_index) const {
-        return active_flags[element_index];
+        return (m_active_words[element_index >> 6] >> (element_index & 63)) & 1;
     }
     inline size_t num_elements() const { return m_num_elements; }
 
+    // One past the greatest index that has been allocated. All active elements have indices less than this.
+    inline ElementIndex end_index() const { return m_end; }
+    // True if every index in [0, end_index()) is active.
+    inline bool dense() const { return m_num_elements == m_end; }
+    // The maximal runs of active indices, as (first index, number of indices) pairs in index order.
+    // A dense pool has at most one run.
+    std::vector<std::pair<ElementIndex, size_t>> active_runs() const;
+
+    // Memory.
+    // The bytes allocated for the pool's own bookkeeping (the active flags and the free-list), not including the attachments.
+    size_t allocated_bytes() const;
+    // Reduce the capacity of the pool and all attachments to end_index(), and release spare bookkeeping memory.
+    // Indices are unchanged, so removed slots before end_index() are kept (see compact() to remove them).
+    void shrink_to_fit();
+
     void printout();
 
-    ElementPoolIterator begin();
-    ElementPoolIterator end();
+    ElementPoolIterator begin() const;
+    ElementPoolIterator end() const;
     
 private:
-    std::vector<bool> active_flags;
+    // Active flags are stored as a bitmap, 64 elements per word. Bit (i % 64) of word (i / 64) is set iff element i is active.
+    std::vector<uint64_t> m_active_words;
     std::vector<ElementAttachmentBase *> attachments;
 
     // implementation details.
-    ElementIndex least_inactive_index;
+    // Removed element indices are kept on a free-list (used as a stack) so that add() is O(1).
+    // If nothing has been removed, the free-list is empty and elements are allocated contiguously from 0.
+    std::vector<ElementIndex> m_free_list;
+    ElementIndex m_end; // One past the greatest index that has been allocated.
+    size_t m_capacity;
 
     size_t m_num_elements; // This must be kept up-to-date.
 
+    void grow(size_t new_capacity);
+
     template <typename T>
     friend class ElementAttachment;
+    friend class ElementPoolIterator;
+    friend class MeshVersions;
+    friend class SurfaceMesh; // Memory usage is reported per attachment.
+};
+
+
+inline ElementPoolIterator &ElementPoolIterator::operator++()
+{
+    ++element_index;
+    if (!dense || !element_pool->dense()) {
+        dense = false;
+        element_index = next_active(element_index);
+    }
+    return *this;
+}
+
+
+/*--------------------------------------------------------------------------------
+    Trivial attachment entries.
+    Entries of a trivial type are not constructed when an element is added or destroyed when it is removed
+    (unless the attachment has a default value, which is copied in), and are moved with memcpy and realloc.
+    This is std::is_trivially_copyable, and is specialized for types which are trivial in practice but not
+    by the standard's definition, such as fixed-size Eigen vectors (see surface_geometry.h).
+--------------------------------------------------------------------------------*/
+template <typename T>
+struct TrivialAttachmentEntry : std::is_trivially_copyable<T> {};
+
+// Storage for trivial entries. Unlike std::vector, this doesn't initialize entries when it grows, and grows with realloc,
+// which can often extend the allocation in place.
+template <typename T>
+class TrivialArray {
+public:
+    // The entries are left uninitialized.
+    TrivialArray(size_t n);
+    TrivialArray(size_t n, const T &value);
+    ~TrivialArray();
+    TrivialArray(const TrivialArray &other);
+    TrivialArray(TrivialArray &&other);
+    TrivialArray &operator=(const TrivialArray &) = delete;
+
+    void resize(size_t n);
+    // resize() reallocates to exactly n entries, so there is no spare capacity.
+    inline size_t capacity() const { return m_size; }
+    inline void shrink_to_fit() {}
+    inline void swap(TrivialArray &other) { std::swap(m_data, other.m_data); std::swap(m_size, other.m_size); }
+    inline size_t size() const { return m_size; }
+    inline T *data() { return m_data; }
+    inline const T *data() const { return m_data; }
+    inline T &operator[](size_t i) { return m_data[i]; }
+    inline const T &operator[](size_t i) const { return m_data[i]; }
+    inline T *begin() { return m_data; }
+    inline T *end() { return m_data + m_size; }
+    inline const T *begin() const { return m_data; }
+    inline const T *end() const { return m_data + m_size; }
+private:
+    T *m_data;
+    size_t m_size;
+};
+
+
+/*--------------------------------------------------------------------------------
+    RawAttachmentView
+    A type-erased view of an attachment's storage, for handing per-element data to writers and other libraries
+    without copying it. The entry of element index i is at data + i*stride, for i < end_index.
+    Entries of inactive elements (holes in the pool) are unspecified. If dense, there are none, and the view is
+    a packed array of num_elements entries.
+    As with ElementAttachment::data_pointer(), this is invalidated when elements are added.
+--------------------------------------------------------------------------------*/
+struct RawAttachmentView {
+    uint8_t *data;
+    size_t stride; // In bytes. This is the size of the entry type.
+    size_t end_index;
+    size_t num_elements;
+    bool dense;
+    const ElementPool *pool;
+
+    inline bool null() const { return data == nullptr; }
+    inline bool is_active(ElementIndex element_index) const { return pool->is_active(element_index); }
+    template <typename T>
+    inline T *entries() const { assert(sizeof(T) == stride); return reinterpret_cast<T *>(data); }
 };
 
 
@@ -75,19 +279,32 @@ private:
     ElementAttachmentBase and ElementAttachment<T>
 --------------------------------------------------------------------------------*/
 class ElementAttachmentBase {
+public:
+    virtual ~ElementAttachmentBase() {}
 protected:
-    ElementAttachmentBase(size_t _type_size);
+    ElementAttachmentBase(size_t _type_size, bool _trivial);
     size_t type_size;
     uint8_t *raw_data;
+    // If trivial, the pool creates and destroys entries itself rather than through the virtual methods:
+    // nothing is done, except copying in the default value, if raw_default_value is not null.
+    bool trivial;
+    const uint8_t *raw_default_value;
     
 private:
     // Virtual shadowing methods. These provide a generic interface to update the templated ElementAttachment's vector<T>
     // to match the layout of the ElementPool.
     virtual void resize(size_t n) = 0;
     virtual void create(ElementIndex element_index) = 0;
+    virtual void create_range(ElementIndex first_index, size_t n) = 0;
     virtual void destroy(ElementIndex element_index) = 0;
+    // Gather the entries so that new entry i is old entry new_to_old[i], for i < num_entries, and set the size to capacity.
+    virtual void permute(const ElementIndex *new_to_old, size_t num_entries, size_t capacity) = 0;
+    // The bytes allocated for the entries. Memory owned by the entries themselves (e.g. if T is a std::vector) is not counted.
+    virtual size_t allocated_bytes() const = 0;
 
     friend class ElementPool; // ElementPool needs access to the virtual shadowing methods.
+    friend class MeshVersions; // Snapshots copy the raw data.
+    friend class SurfaceMesh; // Named attachments give raw views.
 };
 
 
@@ -95,17 +312,46 @@ template <typename T>
 class ElementAttachment : public ElementAttachmentBase {
 public:
     ~ElementAttachment();
+    // The entry of element index i is data_pointer()[i]. Entries of inactive elements are unspecified.
+    // This is invalidated when elements are added.
+    inline T *data_pointer() { return data.data(); }
+    inline const T *data_pointer() const { return data.data(); }
+    // Copy the entries of an attachment on another pool with the same elements (e.g. copied with ElementPool::copy()).
+    // Trivial entries are copied in bulk.
+    void copy(const ElementAttachment<T> &other);
+    // Set the entries of all elements (active or not) to value. For trivially copyable T this is a store over the raw storage.
+    // The default value (if any) is not changed.
+    void fill(const T &value);
+    inline bool has_default_value() const { return m_has_default_value; }
+    // A view of the storage. This doesn't copy, so gives mutable entries even from a const attachment.
+    RawAttachmentView raw_view() const;
 protected:
     ElementAttachment(ElementPool &_pool);
+    // All entries start as default_value, and elements added later are given default_value instead of being default-initialized.
+    ElementAttachment(ElementPool &_pool, const T &default_value);
     const T &get(ElementIndex element_index) const;
     T &get(ElementIndex element_index); // [] overload isn't used here since the only users are derived classes.
 private:
     virtual void resize(size_t n) final;
     virtual void create(ElementIndex element_index) final;
+    virtual void create_range(ElementIndex first_index, size_t n) final;
     virtual void destroy(ElementIndex element_index) final;
+    virtual void permute(const ElementIndex *new_to_old, size_t num_entries, size_t capacity) final;
+    virtual size_t allocated_bytes() const final { return data.capacity() * sizeof(T); }
+    void copy_entries(const ElementAttachment<T> &other, size_t n, std::true_type trivially_copyable);
+    void copy_entries(const ElementAttachment<T> &other, size_t n, std::false_type trivially_copyable);
+
+    typedef typename std::conditional<TrivialAttachmentEntry<T>::value, TrivialArray<T>, std::vector<T>>::type Storage;
 
     ElementPool &pool;
-    std::vector<T> data;
+    Storage data;
+    bool m_has_default_value;
+    T m_default_value;
+
+    // The halfedge incidence layouts are attached directly to the halfedge pool.
+    friend class HalfedgeIncidenceAoS;
+    friend class HalfedgeIncidenceSoA;
+    friend class MeshVersions;
 };
 
 
@@ -117,8 +363,11 @@ template <typename T>
 class VertexAttachment : public ElementAttachment<T> {
 public:
     VertexAttachment(SurfaceMesh &mesh);
+    VertexAttachment(SurfaceMesh &mesh, const T &default_value);
     const T &operator[](const Vertex &vertex) const;
     T &operator[](const Vertex &vertex);
+    const T &operator[](VertexId vertex) const;
+    T &operator[](VertexId vertex);
 };
 
 
@@ -126,8 +375,11 @@ template <typename T>
 class HalfedgeAttachment : public ElementAttachment<T> {
 public:
     HalfedgeAttachment(SurfaceMesh &mesh);
+    HalfedgeAttachment(SurfaceMesh &mesh, const T &default_value);
     const T &operator[](const Halfedge &halfedge) const;
     T &operator[](const Halfedge &halfedge);
+    const T &operator[](HalfedgeId halfedge) const;
+    T &operator[](HalfedgeId halfedge);
 };
 
 
@@ -135,8 +387,11 @@ template <typename T>
 class EdgeAttachment : public ElementAttachment<T> {
 public:
     EdgeAttachment(SurfaceMesh &mesh);
+    EdgeAttachment(SurfaceMesh &mesh, const T &default_value);
     const T &operator[](const Edge &edge) const;
     T &operator[](const Edge &edge);
+    const T &operator[](EdgeId edge) const;
+    T &operator[](EdgeId edge);
 };
 
 
@@ -144,8 +399,11 @@ template <typename T>
 class FaceAttachment : public ElementAttachment<T> {
 public:
     FaceAttachment(SurfaceMesh &mesh);
+    FaceAttachment(SurfaceMesh &mesh, const T &default_value);
     const T &operator[](const Face &face) const;
     T &operator[](const Face &face);
+    const T &operator[](FaceId face) const;
+    T &operator[](FaceId face);
 };
 
 
@@ -171,8 +429,190 @@ struct EdgeIncidenceData {
 };
 
 
+/*--------------------------------------------------------------------------------
+    Halfedge incidence layout.
+    Halfedge incidences can be stored as one interleaved HalfedgeIncidenceData record per halfedge (array-of-structures),
+    or as a separate array per relation (structure-of-arrays). One-ring circulation only reads twin and next, so with
+    the SoA layout it does not pull the other 12 bytes of each record into cache. The cost is five attachments to
+    update (instead of one) when halfedges are added, removed or moved.
+
+    The layout is a compile-time choice: MESH_PROCESSING_HALFEDGE_SOA selects the SoA layout (see CMakeLists.txt).
+    Both layouts have the same interface, and all halfedge incidence access goes through it.
+--------------------------------------------------------------------------------*/
+class HalfedgeIncidenceAoS {
+public:
+    HalfedgeIncidenceAoS(ElementPool &pool) : data(pool) {}
+    static const char *layout_name() { return "AoS"; }
+
+    inline ElementIndex &next(ElementIndex i) { return data.get(i).next_index; }
+    inline ElementIndex &vertex(ElementIndex i) { return data.get(i).vertex_index; }
+    inline ElementIndex &face(ElementIndex i) { return data.get(i).face_index; }
+    inline ElementIndex &twin(ElementIndex i) { return data.get(i).twin_index; }
+    inline ElementIndex &edge(ElementIndex i) { return data.get(i).edge_index; }
+    inline ElementIndex next(ElementIndex i) const { return data.get(i).next_index; }
+    inline ElementIndex vertex(ElementIndex i) const { return data.get(i).vertex_index; }
+    inline ElementIndex face(ElementIndex i) const { return data.get(i).face_index; }
+    inline ElementIndex twin(ElementIndex i) const { return data.get(i).twin_index; }
+    inline ElementIndex edge(ElementIndex i) const { return data.get(i).edge_index; }
+
+    // Unchecked read-only access through a pointer to the storage (see UncheckedTraversal).
+    struct View {
+        const HalfedgeIncidenceData *data;
+        inline ElementIndex next(ElementIndex i) const { return data[i].next_index; }
+        inline ElementIndex vertex(ElementIndex i) const { return data[i].vertex_index; }
+        inline ElementIndex face(ElementIndex i) const { return data[i].face_index; }
+        inline ElementIndex twin(ElementIndex i) const { return data[i].twin_index; }
+        inline ElementIndex edge(ElementIndex i) const { return data[i].edge_index; }
+    };
+    inline View view() const { return View{data.data_pointer()}; }
+    inline void copy(const HalfedgeIncidenceAoS &other) { data.copy(other.data); }
+    // The attachment storing each relation (next, vertex, face, twin, edge), and the relation's byte offset in its entries.
+    inline void relation_storage(const ElementAttachmentBase *attachments[5], size_t offsets[5]) const {
+        for (int i = 0; i < 5; i++) attachments[i] = &data;
+        offsets[0] = offsetof(HalfedgeIncidenceData, next_index);
+        offsets[1] = offsetof(HalfedgeIncidenceData, vertex_index);
+        offsets[2] = offsetof(HalfedgeIncidenceData, face_index);
+        offsets[3] = offsetof(HalfedgeIncidenceData, twin_index);
+        offsets[4] = offsetof(HalfedgeIncidenceData, edge_index);
+    }
+private:
+    ElementAttachment<HalfedgeIncidenceData> data;
+};
+
+class HalfedgeIncidenceSoA {
+public:
+    HalfedgeIncidenceSoA(ElementPool &pool) :
+        next_data(pool), vertex_data(pool), face_data(pool), twin_data(pool), edge_data(pool)
+    {}
+    static const char *layout_name() { return "SoA"; }
+
+    inline ElementIndex &next(ElementIndex i) { return next_data.get(i); }
+    inline ElementIndex &vertex(ElementIndex i) { return vertex_data.get(i); }
+    inline ElementIndex &face(ElementIndex i) { return face_data.get(i); }
+    inline ElementIndex &twin(ElementIndex i) { return twin_data.get(i); }
+    inline ElementIndex &edge(ElementIndex i) { return edge_data.get(i); }
+    inline ElementIndex next(ElementIndex i) const { return next_data.get(i); }
+    inline ElementIndex vertex(ElementIndex i) const { return vertex_data.get(i); }
+    inline ElementIndex face(ElementIndex i) const { return face_data.get(i); }
+    inline ElementIndex twin(ElementIndex i) const { return twin_data.get(i); }
+    inline ElementIndex edge(ElementIndex i) const { return edge_data.get(i); }
+
+    // Unchecked read-only access through pointers to the storage (see UncheckedTraversal).
+    struct View {
+        const ElementIndex *next_data;
+        const ElementIndex *vertex_data;
+        const ElementIndex *face_data;
+        const ElementIndex *twin_data;
+        const ElementIndex *edge_data;
+        inline ElementIndex next(ElementIndex i) const { return next_data[i]; }
+        inline ElementIndex vertex(ElementIndex i) const { return vertex_data[i]; }
+        inline ElementIndex face(ElementIndex i) const { return face_data[i]; }
+        inline ElementIndex twin(ElementIndex i) const { return twin_data[i]; }
+        inline ElementIndex edge(ElementIndex i) const { return edge_data[i]; }
+    };
+    inline View view() const {
+        return View{next_data.data_pointer(), vertex_data.data_pointer(), face_data.data_pointer(),
+                    twin_data.data_pointer(), edge_data.data_pointer()};
+    }
+    inline void copy(const HalfedgeIncidenceSoA &other) {
+        next_data.copy(other.next_data);
+        vertex_data.copy(other.vertex_data);
+        face_data.copy(other.face_data);
+        twin_data.copy(other.twin_data);
+        edge_data.copy(other.edge_data);
+    }
+    inline void relation_storage(const ElementAttachmentBase *attachments[5], size_t offsets[5]) const {
+        attachments[0] = &next_data;
+        attachments[1] = &vertex_data;
+        attachments[2] = &face_data;
+        attachments[3] = &twin_data;
+        attachments[4] = &edge_data;
+        for (int i = 0; i < 5; i++) offsets[i] = 0;
+    }
+private:
+    ElementAttachment<ElementIndex> next_data;
+    ElementAttachment<ElementIndex> vertex_data;
+    ElementAttachment<ElementIndex> face_data;
+    ElementAttachment<ElementIndex> twin_data;
+    ElementAttachment<ElementIndex> edge_data;
+};
+
+#ifdef MESH_PROCESSING_HALFEDGE_SOA
+typedef HalfedgeIncidenceSoA HalfedgeIncidence;
+#else
+typedef HalfedgeIncidenceAoS HalfedgeIncidence;
+#endif
 
 
+/*--------------------------------------------------------------------------------
+    UncheckedTraversal
+    The index-based traversal methods of SurfaceMesh, without any checks, for tight kernels.
+    This is made by SurfaceMesh::unchecked(), which checks once that the mesh is locked (if checks are enabled). It reads the incidence
+    arrays directly, so it is invalidated by any edit of the mesh.
+    usage:
+        auto traversal = mesh.unchecked();
+        for (auto v : mesh.vertices()) {
+            auto start = traversal.halfedge(v.id());
+            ...
+        }
+--------------------------------------------------------------------------------*/
+class UncheckedTraversal {
+public:
+    inline HalfedgeId next(HalfedgeId halfedge) const { return HalfedgeId(halfedge_incidence.next(halfedge.index())); }
+    inline HalfedgeId twin(HalfedgeId halfedge) const { return HalfedgeId(halfedge_incidence.twin(halfedge.index())); }
+    inline VertexId vertex(HalfedgeId halfedge) const { return VertexId(halfedge_incidence.vertex(halfedge.index())); }
+    inline VertexId tip(HalfedgeId halfedge) const { return vertex(next(halfedge)); }
+    inline FaceId face(HalfedgeId halfedge) const { return FaceId(halfedge_incidence.face(halfedge.index())); }
+    inline EdgeId edge(HalfedgeId halfedge) const { return EdgeId(halfedge_incidence.edge(halfedge.index())); }
+    inline HalfedgeId halfedge(VertexId vertex) const { return HalfedgeId(vertex_incidence[vertex.index()].halfedge_index); }
+    inline HalfedgeId halfedge(FaceId face) const { return HalfedgeId(face_incidence[face.index()].halfedge_index); }
+    inline HalfedgeId halfedge_a(EdgeId edge) const { return HalfedgeId(edge_incidence[edge.index()].halfedge_indices[0]); }
+    inline HalfedgeId halfedge_b(EdgeId edge) const { return HalfedgeId(edge_incidence[edge.index()].halfedge_indices[1]); }
+    inline bool on_boundary(VertexId vertex) const { return vertex_on_boundary[vertex.index()] != 0; }
+    inline bool on_boundary(EdgeId edge) const {
+        return face(halfedge_a(edge)).null() || face(halfedge_b(edge)).null();
+    }
+    inline size_t num_adjacent_vertices(VertexId vertex) const {
+        auto start = halfedge(vertex);
+        auto he = start;
+        size_t n = 0;
+        do {
+            n++;
+        } while ((he = next(twin(he))) != start);
+        return n;
+    }
+
+    // Circulators (see circulators.h), giving ids.
+    typedef CirculatorRange<const UncheckedTraversal, Circulation::OutgoingHalfedges> OutgoingHalfedgeRange;
+    typedef CirculatorRange<const UncheckedTraversal, Circulation::IncomingHalfedges> IncomingHalfedgeRange;
+    typedef CirculatorRange<const UncheckedTraversal, Circulation::OneRing> OneRingRange;
+    typedef CirculatorRange<const UncheckedTraversal, Circulation::Fan> FanRange;
+    typedef CirculatorRange<const UncheckedTraversal, Circulation::HalfedgeLoop> HalfedgeLoopRange;
+    typedef CirculatorRange<const UncheckedTraversal, Circulation::LoopVertices> LoopVerticesRange;
+    inline OutgoingHalfedgeRange outgoing_halfedges(VertexId vertex) const;
+    inline IncomingHalfedgeRange incoming_halfedges(VertexId vertex) const;
+    inline OneRingRange one_ring(VertexId vertex) const;
+    inline FanRange fan(VertexId vertex) const;
+    inline HalfedgeLoopRange loop(HalfedgeId start) const;
+    inline HalfedgeLoopRange face_halfedges(FaceId face) const;
+    inline LoopVerticesRange face_vertices(FaceId face) const;
+    inline std::array<VertexId, 3> triangle_vertices(FaceId face) const;
+private:
+    HalfedgeIncidence::View halfedge_incidence;
+    const VertexIncidenceData *vertex_incidence;
+    const EdgeIncidenceData *edge_incidence;
+    const FaceIncidenceData *face_incidence;
+    const uint8_t *vertex_on_boundary;
+
+    UncheckedTraversal(const SurfaceMesh &mesh);
+    friend class SurfaceMesh;
+};
+
+
+
+
+// Element handles pair an element index with its mesh, for convenient traversal (he.twin().next().vertex()).
+// They are thin wrappers over the index-based traversal methods of SurfaceMesh.
 class ElementHandle {
 public:
     inline ElementIndex index() const { return m_index; }
@@ -181,12 +621,12 @@ public:
     inline bool operator==(const ElementHandle &other) const { return m_index == other.m_index; }
     inline bool operator!=(const ElementHandle &other) const { return !(*this == other); }
 
-    ElementHandle &operator=(const ElementHandle &other);
-
     inline bool null() const { return m_index == InvalidElementIndex; }
 protected:
-    ElementHandle(SurfaceMesh &_mesh, ElementIndex _index);
-    SurfaceMesh &mesh;
+    ElementHandle(SurfaceMesh &_mesh, ElementIndex _index) :
+        mesh{&_mesh}, m_index{_index}
+    {}
+    SurfaceMesh *mesh; // A pointer rather than a reference, so that handles are copy-assignable.
     ElementIndex m_index;
     friend class SurfaceMesh;
 };
@@ -195,18 +635,28 @@ protected:
 extern SurfaceMesh g_dummy_surface_mesh;
 class Vertex : public ElementHandle {
 public:
-    Halfedge halfedge() const; // Only valid when the mesh is locked (single vertex->halfedge relations don't give full traversals for unlocked (non-manifold) meshes.)
-    size_t num_adjacent_vertices() const; // Only valid when mesh is locked.
+    inline Halfedge halfedge() const; // Only valid when the mesh is locked (single vertex->halfedge relations don't give full traversals for unlocked (non-manifold) meshes.)
+    inline size_t num_adjacent_vertices() const; // Only valid when mesh is locked.
     Vertex() :
         ElementHandle(g_dummy_surface_mesh, InvalidElementIndex)
     {}
 
-    bool on_boundary() const; // Only valid when mesh is locked.
+    inline bool on_boundary() const; // Only valid when mesh is locked.
+
+    // Circulators (see circulators.h). Only valid when the mesh is locked.
+    inline OutgoingHalfedgeRange outgoing_halfedges() const;
+    inline IncomingHalfedgeRange incoming_halfedges() const;
+    inline OneRingRange one_ring() const; // Adjacent vertices.
+    inline FanRange fan() const; // Incident faces.
 
     //todo: Hide from public interface.
     Vertex(SurfaceMesh &_mesh, ElementIndex _index) :
         ElementHandle(_mesh, _index)
     {}
+    Vertex(SurfaceMesh &_mesh, VertexId id) :
+        ElementHandle(_mesh, id.index())
+    {}
+    inline VertexId id() const { return VertexId(m_index); }
 
 private:
     void set_halfedge(Halfedge halfedge);
@@ -217,12 +667,15 @@ private:
 
 class Halfedge : public ElementHandle {
 public:
-    Halfedge next() const;
-    Halfedge twin() const;
-    Vertex vertex() const;
-    Vertex tip() const;
-    Face face() const;
-    Edge edge() const;
+    inline Halfedge next() const;
+    inline Halfedge twin() const;
+    inline Vertex vertex() const;
+    inline Vertex tip() const;
+    inline Face face() const;
+    inline Edge edge() const; // Only valid when the mesh is locked.
+    // The halfedges (or their vertices) of this halfedge's face or boundary loop, starting from this one.
+    inline HalfedgeLoopRange loop() const;
+    inline LoopVerticesRange loop_vertices() const;
 
     Halfedge() :
         ElementHandle(g_dummy_surface_mesh, InvalidElementIndex)
@@ -231,6 +684,10 @@ public:
     Halfedge(SurfaceMesh &_mesh, ElementIndex _index) :
         ElementHandle(_mesh, _index)
     {}
+    Halfedge(SurfaceMesh &_mesh, HalfedgeId id) :
+        ElementHandle(_mesh, id.index())
+    {}
+    inline HalfedgeId id() const { return HalfedgeId(m_index); }
 private:
     void set_vertex(Vertex vertex);
     void set_face(Face face);
@@ -244,8 +701,15 @@ private:
 
 class Face : public ElementHandle {
 public:
-    Halfedge halfedge() const;
-    size_t num_vertices() const;
+    inline Halfedge halfedge() const;
+    inline size_t num_vertices() const;
+
+    // Circulators (see circulators.h).
+    inline HalfedgeLoopRange halfedges() const;
+    inline LoopVerticesRange vertices() const;
+    // For triangles, the three halfedges or vertices are found in exactly three steps.
+    inline std::array<Halfedge, 3> triangle_halfedges() const;
+    inline std::array<Vertex, 3> triangle_vertices() const;
 
     Face() :
         ElementHandle(g_dummy_surface_mesh, InvalidElementIndex)
@@ -254,6 +718,10 @@ public:
     Face(SurfaceMesh &_mesh, ElementIndex _index) :
         ElementHandle(_mesh, _index)
     {}
+    Face(SurfaceMesh &_mesh, FaceId id) :
+        ElementHandle(_mesh, id.index())
+    {}
+    inline FaceId id() const { return FaceId(m_index); }
 private:
     void set_halfedge(Halfedge halfedge);
     friend class SurfaceMesh;
@@ -262,12 +730,10 @@ private:
 // note: Edges only make sense when the mesh is locked (all halfedges have a twin).
 class Edge : public ElementHandle {
 public:
-    Halfedge a() const;
-    Halfedge b() const;
+    inline Halfedge a() const;
+    inline Halfedge b() const;
 
-    inline bool on_boundary() const {
-        return a().face().null() || b().face().null();
-    };
+    inline bool on_boundary() const;
 
     Edge() :
         ElementHandle(g_dummy_surface_mesh, InvalidElementIndex)
@@ -276,6 +742,10 @@ public:
     Edge(SurfaceMesh &_mesh, ElementIndex _index) :
         ElementHandle(_mesh, _index)
     {}
+    Edge(SurfaceMesh &_mesh, EdgeId id) :
+        ElementHandle(_mesh, id.index())
+    {}
+    inline EdgeId id() const { return EdgeId(m_index); }
 private:
     void set_halfedge_a(Halfedge halfedge);
     void set_halfedge_b(Halfedge halfedge);
@@ -288,7 +758,7 @@ private:
 template <typename T>
 class ElementIterator {
 public:
-    ElementIterator(SurfaceMesh *_mesh, ElementPool *_element_pool, ElementIndex _element_index);
+    ElementIterator(SurfaceMesh *_mesh, ElementPoolIterator _element_pool_iterator);
     T operator*();
     ElementIterator<T> &operator++();
     bool operator==(const ElementIterator &other) const;
@@ -300,6 +770,22 @@ private:
 };
 
 
+/*--------------------------------------------------------------------------------
+    Named attachments ("properties").
+    A property is an attachment owned by the mesh and found by name, so that it doesn't have to be kept alive
+    by whoever made it. Names are unique per element type, e.g. a mesh can have both a vertex and a face "area".
+--------------------------------------------------------------------------------*/
+enum class ElementType { Vertex, Halfedge, Edge, Face };
+const char *element_type_name(ElementType element_type);
+
+struct PropertyInfo {
+    std::string name;
+    ElementType element_type;
+    std::type_index type;
+    size_t type_size;
+};
+
+
 /* Important invariants:
  *    If nothing is deleted from a surface mesh, then elements must be contiguous. The ability to make this assumption is useful (e.g. when loading from
  *    a triangle list).
@@ -308,7 +794,13 @@ class SurfaceMesh {
 public:
     SurfaceMesh();
 
-    // Copy assignment.
+    // Copying.
+    // The copy has the same elements with the same indices, and the same lock state and topology data (lock() is not re-run).
+    // The incidence data and the named attachments (properties) are copied in bulk. Other attachments are owned outside
+    // of the mesh (e.g. SurfaceGeometry::position), so are not copied with it: to copy one, make it on the copy then use
+    // ElementAttachment::copy().
+    // The entries of the attachments on the assigned-to mesh are unspecified after the assignment.
+    SurfaceMesh(const SurfaceMesh &other);
     SurfaceMesh &operator=(const SurfaceMesh &other);
 
     // Raw editing methods.
@@ -321,21 +813,48 @@ public:
     bool remove_vertex(Vertex vertex); // Remove an isolated vertex.
     bool remove_face(Face face); // Remove a face and all its halfedges. Vertices are unaffected.
 
+    // Bulk raw editing.
+    // These build directly from contiguous index arrays, allocating each pool once, and give the same result as
+    // adding the elements one at a time (except that removed slots are not reused). New elements get contiguous indices,
+    // so for an empty mesh, vertex i of an indexed face list is the vertex with index i.
+    ElementIndex add_vertices(size_t num_vertices); // Returns the index of the first new vertex.
+    // Add faces of face_size vertices each (3 for triangles, 4 for quads). Returns the index of the first new face.
+    ElementIndex add_faces(const ElementIndex *vertex_indices, size_t num_faces, size_t face_size);
+    // Add polygons. Face i has the vertices vertex_indices[face_offsets[i]] to vertex_indices[face_offsets[i+1]-1],
+    // so face_offsets has num_faces+1 entries.
+    ElementIndex add_faces(const ElementIndex *vertex_indices, const ElementIndex *face_offsets, size_t num_faces);
+    // Reserve space for the given total numbers of vertices, halfedges and faces, so that adding up to these doesn't reallocate.
+    // For a mesh which will be locked, num_halfedges should include the boundary halfedges added by lock(). Edges are reserved
+    // for num_halfedges/2.
+    void reserve(size_t num_vertices, size_t num_halfedges, size_t num_faces);
+
     // Euler editing methods.
     // These maintain manifoldness, and are only valid when the mesh is locked.
     void add(SurfaceMesh &mesh);
     void remove_connected_component(Face starting_face);
+    // Local operators. These only touch the elements around the edit, and reuse removed element slots.
+    // Those on edges assume that the faces on the edge are triangles.
+    bool can_flip(Edge edge);
+    bool flip(Edge edge); // Connect the opposite vertices instead. Fails for boundary edges, or if the opposite vertices are already adjacent.
+    Vertex split(Edge edge); // Split at a new vertex, splitting each face on the edge in two.
+    Vertex split(Face face); // Split into triangles around a new vertex.
+    bool can_collapse(Halfedge halfedge); // The collapse keeps the mesh manifold (the link condition holds).
+    bool collapse(Halfedge halfedge); // Merge the halfedge's vertex into its tip. Fails if !can_collapse(halfedge).
 
     // Topology.
-    bool locked() const;
-    void lock();
+    inline bool locked() const { return m_locked; }
+    void lock(); // Runs on Parallel::num_threads() threads (see Parallel::set_num_threads). The result does not depend on the thread count.
     void unlock();
     // Boundary.
     std::vector<Halfedge> boundary_loops();
     size_t num_boundary_loops() const;
-    // Connected components.
-    std::vector<Face> connected_components(); // Returns one face from each connected component.
+    // Connected components (of faces, adjacent across edges).
+    // These are computed with a parallel union-find on the first query after the mesh is edited, and cached until the next edit,
+    // so lock() doesn't compute them. Components are numbered from 0 in the order of their least face index.
+    std::vector<Face> connected_components(); // Returns one face from each connected component (its least face), in order.
     size_t num_connected_components() const;
+    // The component number of each face. This is valid until the mesh is next edited.
+    const FaceAttachment<uint32_t> &connected_component_labels() const;
     // Manifold properties.
     bool closed() const;
     bool connected() const;
@@ -352,6 +871,96 @@ public:
     size_t num_edges() const;
     size_t num_interior_edges() const;
 
+    // Storage.
+    // Removing elements leaves holes in the element pools. garbage_collect() moves the elements of each pool to contiguous
+    // indices from 0 (keeping their order), remaps all incidence data, and moves the data of every attachment with its elements.
+    // If shrink_to_fit is true, the pool capacities are also reduced to the number of elements.
+    // All handles and indices are invalidated. The returned maps give the new index of each old index
+    // (or InvalidElementIndex for slots that were not in use), so that callers can fix external references.
+    struct ElementIndexMaps {
+        std::vector<ElementIndex> vertices;
+        std::vector<ElementIndex> halfedges;
+        std::vector<ElementIndex> edges;
+        std::vector<ElementIndex> faces;
+    };
+    ElementIndexMaps garbage_collect(bool shrink_to_fit = false);
+    // Reorder the elements for locality of traversal, given an order of the vertices (a list of every vertex index).
+    // Faces are sorted by their least new vertex index, and the halfedges are grouped by face (in loop order),
+    // followed by the boundary halfedges grouped by boundary loop. Edges follow the order of their first halfedge.
+    // As with garbage_collect(), the attachment data moves with the elements, the result is compact, and the old-to-new maps are returned.
+    ElementIndexMaps reorder(const std::vector<ElementIndex> &vertex_order);
+    // True if no element pool has holes, so that the element indices are contiguous from 0.
+    bool dense() const;
+
+    // Memory footprint.
+    // Each item gives the bytes allocated (including spare capacity) and the bytes used by live elements or entries.
+    // Growing a pool doubles its capacity, so up to half of the allocation can be spare. Attachments owned outside of the mesh
+    // (e.g. SurfaceGeometry::position) are included, but unnamed. Memory owned by attachment entries themselves is not counted.
+    struct MemoryUsage {
+        struct Item {
+            std::string name;
+            size_t allocated_bytes;
+            size_t used_bytes;
+        };
+        std::vector<Item> pools;       // The bookkeeping of each element pool (active flags and free-list).
+        std::vector<Item> attachments; // Every attachment on each pool: incidence data, caches, properties and external attachments.
+        std::vector<Item> indices;     // The halfedge_map (empty slots are its overhead) and the cached topology.
+        size_t allocated_bytes() const;
+        size_t used_bytes() const;
+        void printout() const;
+    };
+    MemoryUsage memory_usage() const;
+    // Trim the capacity of every pool and attachment to the end index of its pool, and release the spare capacity of the
+    // halfedge_map and the cached topology. Indices are unchanged. A mesh with holes (see dense()) can be shrunk to exactly
+    // the live elements with garbage_collect(true).
+    void shrink_to_fit();
+
+    // Named attachments (see PropertyInfo).
+    // add_*_property() makes an attachment owned by the mesh, with an optional default value (see ElementAttachment),
+    // and it is an error to add a second property with the same name on the same element type.
+    // *_property() finds one by name, and gives null if there is none or it has a different entry type.
+    // The returned attachments stay valid until the property is removed or the mesh is destroyed.
+    // Properties are copied with the mesh.
+    template <typename T> VertexAttachment<T> &add_vertex_property(const std::string &name);
+    template <typename T> VertexAttachment<T> &add_vertex_property(const std::string &name, const T &default_value);
+    template <typename T> VertexAttachment<T> *vertex_property(const std::string &name);
+    template <typename T> HalfedgeAttachment<T> &add_halfedge_property(const std::string &name);
+    template <typename T> HalfedgeAttachment<T> &add_halfedge_property(const std::string &name, const T &default_value);
+    template <typename T> HalfedgeAttachment<T> *halfedge_property(const std::string &name);
+    template <typename T> EdgeAttachment<T> &add_edge_property(const std::string &name);
+    template <typename T> EdgeAttachment<T> &add_edge_property(const std::string &name, const T &default_value);
+    template <typename T> EdgeAttachment<T> *edge_property(const std::string &name);
+    template <typename T> FaceAttachment<T> &add_face_property(const std::string &name);
+    template <typename T> FaceAttachment<T> &add_face_property(const std::string &name, const T &default_value);
+    template <typename T> FaceAttachment<T> *face_property(const std::string &name);
+    bool has_property(ElementType element_type, const std::string &name) const;
+    bool remove_property(ElementType element_type, const std::string &name); // Returns false if there is no such property.
+    std::vector<PropertyInfo> properties() const; // In the order they were added.
+    // A type-erased view of a property's entries, for any entry type. This is null if there is no such property.
+    RawAttachmentView raw_property(ElementType element_type, const std::string &name);
+
+    // Index-based traversal.
+    // The handle traversal methods are wrappers over these, e.g. mesh.next(h) gives the same as Halfedge::next().
+    // Those marked "locked" are only valid when the mesh is locked.
+    inline HalfedgeId next(HalfedgeId halfedge) const { return HalfedgeId(halfedge_incidence_data.next(halfedge.index())); }
+    inline HalfedgeId twin(HalfedgeId halfedge) const { return HalfedgeId(halfedge_incidence_data.twin(halfedge.index())); }
+    inline VertexId vertex(HalfedgeId halfedge) const { return VertexId(halfedge_incidence_data.vertex(halfedge.index())); }
+    inline VertexId tip(HalfedgeId halfedge) const { return vertex(next(halfedge)); }
+    inline FaceId face(HalfedgeId halfedge) const { return FaceId(halfedge_incidence_data.face(halfedge.index())); }
+    inline EdgeId edge(HalfedgeId halfedge) const; // locked
+    inline HalfedgeId halfedge(VertexId vertex) const; // locked
+    inline HalfedgeId halfedge(FaceId face) const { return HalfedgeId(face_incidence_data[face].halfedge_index); }
+    inline HalfedgeId halfedge_a(EdgeId edge) const { return HalfedgeId(edge_incidence_data[edge].halfedge_indices[0]); }
+    inline HalfedgeId halfedge_b(EdgeId edge) const { return HalfedgeId(edge_incidence_data[edge].halfedge_indices[1]); }
+    inline bool on_boundary(VertexId vertex) const; // locked
+    inline bool on_boundary(EdgeId edge) const {
+        return face(halfedge_a(edge)).null() || face(halfedge_b(edge)).null();
+    }
+    size_t num_adjacent_vertices(VertexId vertex) const; // locked
+    size_t num_face_vertices(FaceId face) const;
+    // The same traversal methods without checks, for use within a scope (see UncheckedTraversal). The mesh must be locked.
+    inline UncheckedTraversal unchecked() const;
+
     // Accessors.
     // If there is an edge, this returns the edge between vertex a and b.
     // If not, this gives a null handle. This is only valid when the mesh is locked.
@@ -369,8 +978,23 @@ public:
             mesh{_mesh},
             element_pool{_element_pool}
         {}
-        ElementIterator<T> begin() { return ElementIterator<T>(mesh, element_pool, 0); }
-        ElementIterator<T> end() { return ElementIterator<T>(mesh, element_pool, InvalidElementIndex); }
+        ElementIterator<T> begin() { return ElementIterator<T>(mesh, element_pool->begin()); }
+        ElementIterator<T> end() { return ElementIterator<T>(mesh, element_pool->end()); }
+
+        // Call function(element) for each element, in parallel over dense index ranges (see Parallel::for_range).
+        // The function must be safe to call concurrently on different elements, so it should only write to
+        // data of the element it is given. The mesh must not be edited during the loop.
+        // usage:
+        //     mesh.vertices().parallel_for([&](Vertex v) { area[v] = ...; });
+        template <typename Function>
+        void parallel_for(Function function, size_t grain_size = 0) {
+            bool dense = element_pool->dense();
+            Parallel::for_range(0, element_pool->end_index(), [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    if (dense || element_pool->is_active(ElementIndex(i))) function(T(*mesh, ElementIndex(i)));
+                }
+            }, grain_size);
+        }
     private:
         SurfaceMesh *mesh;
         ElementPool *element_pool;
@@ -400,7 +1024,7 @@ private:
     // Incidence information is stored as a collection of functions of the elements (called "attachments").
     // These are attached to the relevant ElementPools.
     VertexAttachment<VertexIncidenceData> vertex_incidence_data;
-    HalfedgeAttachment<HalfedgeIncidenceData> halfedge_incidence_data;
+    HalfedgeIncidence halfedge_incidence_data; // Indexed by halfedge index, e.g. halfedge_incidence_data.next(i).
     EdgeAttachment<EdgeIncidenceData> edge_incidence_data;
     FaceAttachment<FaceIncidenceData> face_incidence_data;
 
@@ -409,17 +1033,66 @@ private:
     // Map from pairs of vertex indices to halfedge indices.
     // get_halfedge is used to test if there is already a halfedge between two vertices,
     // and when setting up twin incidence relations.
-    std::map<std::pair<ElementIndex, ElementIndex>, ElementIndex> halfedge_map; //vertices to halfedge.
+    VertexPairMap halfedge_map; //vertices to halfedge.
     Halfedge get_halfedge(Vertex u, Vertex v);
 
+    // Helpers for the local Euler operators.
+    void set_edge_halfedges(Edge edge, Halfedge a, Halfedge b);
+    void set_vertex_halfedge(Vertex vertex, Halfedge outgoing);
+    Halfedge previous_halfedge(Halfedge halfedge);
+
+    // Prints the message and exits. Used by traversals which are invalid in the current state of the mesh.
+    [[noreturn]] static void traversal_error(const char *message);
+    // Check that the mesh is locked, if traversal checks are enabled (see MESH_PROCESSING_TRAVERSAL_CHECKS).
+    inline void check_locked(const char *message) const {
+#if MESH_PROCESSING_TRAVERSAL_CHECKS
+        if (!locked()) traversal_error(message);
+#endif
+    }
+
+    // Rewrite all incidence indices (and the halfedge_map and topology caches) through old-to-new index maps.
+    void remap_incidence(const ElementIndexMaps &maps);
+    // Permute every pool (see ElementPool::permute()) given lists of old indices in their new order, then remap the incidences.
+    ElementIndexMaps permute(const ElementIndexMaps &new_to_old);
+
+    template <typename FaceOffsets>
+    ElementIndex add_faces_bulk(const ElementIndex *vertex_indices, size_t num_faces, FaceOffsets face_offset);
+
+    // Named attachment storage. The attachments are destroyed before the pools they are attached to.
+    struct Property {
+        PropertyInfo info;
+        ElementPool *pool;
+        std::unique_ptr<ElementAttachmentBase> attachment;
+        // Make the same attachment on another mesh, with the same entries (the pools must be copies).
+        std::function<ElementAttachmentBase *(SurfaceMesh &, const ElementAttachmentBase &)> copy_to;
+    };
+    std::vector<Property> m_properties;
+    ElementPool &pool(ElementType element_type);
+    Property *find_property(ElementType element_type, const std::string &name);
+    const Property *find_property(ElementType element_type, const std::string &name) const;
+    // Adds the property, which must have a new name on its element type, and returns its attachment.
+    ElementAttachmentBase &insert_property(Property &&property);
+    template <template <typename> class Attachment, typename T, typename... DefaultValue>
+    Attachment<T> &add_property(ElementType element_type, const std::string &name, const DefaultValue &...default_value);
+    template <template <typename> class Attachment, typename T>
+    Attachment<T> *get_property(ElementType element_type, const std::string &name);
+
 
     // Private topology data.
     std::vector<Halfedge> m_boundary_loops;
-    std::vector<Face> m_connected_components;
     bool m_locked;
     int m_num_interior_vertices; // Only valid when locked.
     int m_num_interior_edges;    // Only valid when locked.
 
+    // Cached connected components. Every edit which adds, removes or moves faces or halfedges invalidates them.
+    // The cache is filled by const queries, so is mutable, and the mutex makes concurrent first queries safe.
+    mutable std::mutex m_components_mutex;
+    mutable bool m_components_valid;
+    mutable std::vector<Face> m_connected_components;
+    mutable std::unique_ptr<FaceAttachment<uint32_t>> m_component_labels; // Made on the first query.
+    inline void invalidate_connected_components() { m_components_valid = false; }
+    void update_connected_components() const;
+
     
     template <typename T>
     friend class ElementAttachment;
@@ -436,6 +1109,8 @@ private:
     friend class Halfedge;
     friend class Edge;
     friend class Face;
+    friend class UncheckedTraversal;
+    friend class MeshVersions;
 
     friend class ElementIterator<Vertex>;
     friend class ElementIterator<Halfedge>;
@@ -445,6 +1120,8 @@ private:
 
 
 #include "mesh_processing/surface_mesh/surface_mesh.ipp"
+#include "mesh_processing/surface_mesh/circulators.h"
+#include "mesh_processing/surface_mesh/snapshot.h"
 
 
 
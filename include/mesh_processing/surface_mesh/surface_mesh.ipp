@@ -4,21 +4,81 @@ surface_mesh.ipp
 --------------------------------------------------------------------------------*/ 
 
 
+/*--------------------------------------------------------------------------------
+    TrivialArray template methods.
+--------------------------------------------------------------------------------*/
+template <typename T>
+TrivialArray<T>::TrivialArray(size_t n) :
+    m_data{nullptr}, m_size{0}
+{
+    static_assert(alignof(T) <= alignof(max_align_t), "TrivialArray: malloc doesn't give the alignment of this type.");
+    resize(n);
+}
+template <typename T>
+TrivialArray<T>::TrivialArray(size_t n, const T &value) :
+    TrivialArray(n)
+{
+    std::fill(begin(), end(), value);
+}
+template <typename T>
+TrivialArray<T>::TrivialArray(const TrivialArray &other) :
+    TrivialArray(other.m_size)
+{
+    if (m_size > 0) memcpy(static_cast<void *>(m_data), static_cast<const void *>(other.m_data), m_size * sizeof(T));
+}
+template <typename T>
+TrivialArray<T>::TrivialArray(TrivialArray &&other) :
+    m_data{other.m_data}, m_size{other.m_size}
+{
+    other.m_data = nullptr;
+    other.m_size = 0;
+}
+template <typename T>
+TrivialArray<T>::~TrivialArray()
+{
+    free(m_data);
+}
+template <typename T>
+void TrivialArray<T>::resize(size_t n)
+{
+    // Always keep an allocation, so that data() is not null.
+    T *resized = static_cast<T *>(realloc(static_cast<void *>(m_data), std::max<size_t>(n, 1) * sizeof(T)));
+    if (resized == nullptr) throw std::bad_alloc();
+    m_data = resized;
+    m_size = n;
+}
+
+
 /*--------------------------------------------------------------------------------
     ElementAttachment template methods.
 --------------------------------------------------------------------------------*/
 // Constructor
 template <typename T>
 ElementAttachment<T>::ElementAttachment(ElementPool &_pool) :
-    ElementAttachmentBase(sizeof(T)),
+    ElementAttachmentBase(sizeof(T), TrivialAttachmentEntry<T>::value),
     pool{_pool},
-    data(_pool.capacity())
+    data(_pool.capacity()),
+    m_has_default_value{false},
+    m_default_value()
 {
     // Set the base class's uint8_t pointer.
     raw_data = reinterpret_cast<uint8_t *>(&data[0]);
 
     pool.attachments.push_back(this);
 }
+template <typename T>
+ElementAttachment<T>::ElementAttachment(ElementPool &_pool, const T &default_value) :
+    ElementAttachmentBase(sizeof(T), TrivialAttachmentEntry<T>::value),
+    pool{_pool},
+    data(_pool.capacity(), default_value),
+    m_has_default_value{true},
+    m_default_value(default_value)
+{
+    raw_data = reinterpret_cast<uint8_t *>(&data[0]);
+    raw_default_value = reinterpret_cast<const uint8_t *>(&m_default_value);
+
+    pool.attachments.push_back(this);
+}
 
 
 // Destructor
@@ -33,7 +93,9 @@ ElementAttachment<T>::~ElementAttachment()
 template <typename T>
 const T &ElementAttachment<T>::get(ElementIndex element_index) const
 {
+#if MESH_PROCESSING_TRAVERSAL_CHECKS
     assert(pool.is_active(element_index));
+#endif
     return data[element_index];
 }
 template <typename T>
@@ -49,15 +111,34 @@ T &ElementAttachment<T>::get(ElementIndex element_index)
 template <typename T>
 void ElementAttachment<T>::resize(size_t n)
 {
+    bool shrinking = n < data.size();
     data.resize(n);
+    if (shrinking) data.shrink_to_fit(); // Release the memory (see ElementPool::shrink_to_fit()).
+    raw_data = reinterpret_cast<uint8_t *>(&data[0]); // The vector may have been reallocated.
 }
 
 
 template <typename T>
 void ElementAttachment<T>::create(ElementIndex element_index)
 {
-    // Default-initialize the entry.
-    new (&data[element_index]) T;
+    // Default-initialize the entry, or copy the default value.
+    if (m_has_default_value) new (&data[element_index]) T(m_default_value);
+    else new (&data[element_index]) T;
+}
+
+
+template <typename T>
+void ElementAttachment<T>::create_range(ElementIndex first_index, size_t n)
+{
+    // Default-initialize the entries, or copy the default value.
+    T *entries = data.data() + first_index;
+    if (m_has_default_value) {
+        std::uninitialized_fill_n(entries, n, m_default_value);
+        return;
+    }
+    for (size_t i = 0; i < n; i++) {
+        new (&entries[i]) T;
+    }
 }
 
 
@@ -69,6 +150,53 @@ void ElementAttachment<T>::destroy(ElementIndex element_index)
 }
 
 
+template <typename T>
+void ElementAttachment<T>::permute(const ElementIndex *new_to_old, size_t num_entries, size_t capacity)
+{
+    // Gather into new storage, which is swapped in.
+    Storage permuted_data(capacity);
+    for (size_t i = 0; i < num_entries; i++) {
+        permuted_data[i] = std::move(data[new_to_old[i]]);
+    }
+    data.swap(permuted_data);
+    raw_data = reinterpret_cast<uint8_t *>(&data[0]);
+}
+
+
+template <typename T>
+void ElementAttachment<T>::copy(const ElementAttachment<T> &other)
+{
+    assert(pool.capacity() == other.pool.capacity() && pool.end_index() == other.pool.end_index());
+    // Entries past the end index are never active, so don't need to be copied.
+    copy_entries(other, other.pool.end_index(), std::integral_constant<bool, TrivialAttachmentEntry<T>::value>());
+}
+template <typename T>
+void ElementAttachment<T>::fill(const T &value)
+{
+    // std::fill becomes a memset for byte-sized T, and a vectorized store loop for other trivially copyable T.
+    std::fill(data.begin(), data.end(), value);
+}
+
+
+template <typename T>
+RawAttachmentView ElementAttachment<T>::raw_view() const
+{
+    return {raw_data, type_size, pool.end_index(), pool.num_elements(), pool.dense(), &pool};
+}
+
+
+template <typename T>
+void ElementAttachment<T>::copy_entries(const ElementAttachment<T> &other, size_t n, std::true_type)
+{
+    if (n > 0) memcpy(static_cast<void *>(data.data()), static_cast<const void *>(other.data.data()), n * sizeof(T));
+}
+template <typename T>
+void ElementAttachment<T>::copy_entries(const ElementAttachment<T> &other, size_t n, std::false_type)
+{
+    std::copy(other.data.begin(), other.data.begin() + n, data.begin());
+}
+
+
 
 /*--------------------------------------------------------------------------------
     Vertex, Halfedge, and Face element attachment template methods.
@@ -80,6 +208,10 @@ template <typename T>
 VertexAttachment<T>::VertexAttachment(SurfaceMesh &mesh) :
     ElementAttachment<T>(mesh.vertex_pool)
 {}
+template <typename T>
+VertexAttachment<T>::VertexAttachment(SurfaceMesh &mesh, const T &default_value) :
+    ElementAttachment<T>(mesh.vertex_pool, default_value)
+{}
 
 template <typename T>
 const T &VertexAttachment<T>::operator[](const Vertex &vertex) const
@@ -91,6 +223,16 @@ T &VertexAttachment<T>::operator[](const Vertex &vertex)
 {
     return const_cast<T &>(const_cast<const VertexAttachment<T> *>(this)->operator[](vertex));
 }
+template <typename T>
+const T &VertexAttachment<T>::operator[](VertexId vertex) const
+{
+    return this->get(vertex.index());
+}
+template <typename T>
+T &VertexAttachment<T>::operator[](VertexId vertex)
+{
+    return this->get(vertex.index());
+}
 
 
 /*--------------------------------------------------------------------------------
@@ -100,6 +242,10 @@ template <typename T>
 HalfedgeAttachment<T>::HalfedgeAttachment(SurfaceMesh &mesh) :
     ElementAttachment<T>(mesh.halfedge_pool)
 {}
+template <typename T>
+HalfedgeAttachment<T>::HalfedgeAttachment(SurfaceMesh &mesh, const T &default_value) :
+    ElementAttachment<T>(mesh.halfedge_pool, default_value)
+{}
 
 template <typename T>
 const T &HalfedgeAttachment<T>::operator[](const Halfedge &halfedge) const
@@ -111,6 +257,16 @@ T &HalfedgeAttachment<T>::operator[](const Halfedge &halfedge)
 {
     return const_cast<T &>(const_cast<const HalfedgeAttachment<T> *>(this)->operator[](halfedge));
 }
+template <typename T>
+const T &HalfedgeAttachment<T>::operator[](HalfedgeId halfedge) const
+{
+    return this->get(halfedge.index());
+}
+template <typename T>
+T &HalfedgeAttachment<T>::operator[](HalfedgeId halfedge)
+{
+    return this->get(halfedge.index());
+}
 
 
 /*--------------------------------------------------------------------------------
@@ -120,17 +276,31 @@ template <typename T>
 EdgeAttachment<T>::EdgeAttachment(SurfaceMesh &mesh) :
     ElementAttachment<T>(mesh.edge_pool)
 {}
+template <typename T>
+EdgeAttachment<T>::EdgeAttachment(SurfaceMesh &mesh, const T &default_value) :
+    ElementAttachment<T>(mesh.edge_pool, default_value)
+{}
 
 template <typename T>
-T &EdgeAttachment<T>::operator[](const Edge &edge)
+const T &EdgeAttachment<T>::operator[](const Edge &edge) const
 {
     return this->get(edge.index());
 }
 template <typename T>
-const T &EdgeAttachment<T>::operator[](const Edge &edge) const
+T &EdgeAttachment<T>::operator[](const Edge &edge)
 {
     return const_cast<T &>(const_cast<const EdgeAttachment<T> *>(this)->operator[](edge));
 }
+template <typename T>
+const T &EdgeAttachment<T>::operator[](EdgeId edge) const
+{
+    return this->get(edge.index());
+}
+template <typename T>
+T &EdgeAttachment<T>::operator[](EdgeId edge)
+{
+    return this->get(edge.index());
+}
 
 
 
@@ -142,49 +312,256 @@ template <typename T>
 FaceAttachment<T>::FaceAttachment(SurfaceMesh &mesh) :
     ElementAttachment<T>(mesh.face_pool)
 {}
+template <typename T>
+FaceAttachment<T>::FaceAttachment(SurfaceMesh &mesh, const T &default_value) :
+    ElementAttachment<T>(mesh.face_pool, default_value)
+{}
 
 template <typename T>
-T &FaceAttachment<T>::operator[](const Face &face)
+const T &FaceAttachment<T>::operator[](const Face &face) const
 {
     return this->get(face.index());
 }
 template <typename T>
-const T &FaceAttachment<T>::operator[](const Face &face) const
+T &FaceAttachment<T>::operator[](const Face &face)
 {
     return const_cast<T &>(const_cast<const FaceAttachment<T> *>(this)->operator[](face));
 }
+template <typename T>
+const T &FaceAttachment<T>::operator[](FaceId face) const
+{
+    return this->get(face.index());
+}
+template <typename T>
+T &FaceAttachment<T>::operator[](FaceId face)
+{
+    return this->get(face.index());
+}
+
+/*--------------------------------------------------------------------------------
+    Named attachments.
+--------------------------------------------------------------------------------*/
+template <template <typename> class Attachment, typename T, typename... DefaultValue>
+Attachment<T> &SurfaceMesh::add_property(ElementType element_type, const std::string &name, const DefaultValue &...default_value)
+{
+    auto copy_to = [=](SurfaceMesh &mesh, const ElementAttachmentBase &other) -> ElementAttachmentBase * {
+        auto attachment = new Attachment<T>(mesh, default_value...);
+        attachment->copy(static_cast<const Attachment<T> &>(other));
+        return attachment;
+    };
+    Property property{PropertyInfo{name, element_type, std::type_index(typeid(T)), sizeof(T)}, &pool(element_type),
+                      std::unique_ptr<ElementAttachmentBase>(new Attachment<T>(*this, default_value...)), copy_to};
+    return static_cast<Attachment<T> &>(insert_property(std::move(property)));
+}
+
+template <template <typename> class Attachment, typename T>
+Attachment<T> *SurfaceMesh::get_property(ElementType element_type, const std::string &name)
+{
+    Property *property = find_property(element_type, name);
+    if (property == nullptr || property->info.type != std::type_index(typeid(T))) return nullptr;
+    return static_cast<Attachment<T> *>(property->attachment.get());
+}
+
+template <typename T>
+VertexAttachment<T> &SurfaceMesh::add_vertex_property(const std::string &name)
+{
+    return add_property<VertexAttachment, T>(ElementType::Vertex, name);
+}
+template <typename T>
+VertexAttachment<T> &SurfaceMesh::add_vertex_property(const std::string &name, const T &default_value)
+{
+    return add_property<VertexAttachment, T>(ElementType::Vertex, name, default_value);
+}
+template <typename T>
+VertexAttachment<T> *SurfaceMesh::vertex_property(const std::string &name)
+{
+    return get_property<VertexAttachment, T>(ElementType::Vertex, name);
+}
+
+template <typename T>
+HalfedgeAttachment<T> &SurfaceMesh::add_halfedge_property(const std::string &name)
+{
+    return add_property<HalfedgeAttachment, T>(ElementType::Halfedge, name);
+}
+template <typename T>
+HalfedgeAttachment<T> &SurfaceMesh::add_halfedge_property(const std::string &name, const T &default_value)
+{
+    return add_property<HalfedgeAttachment, T>(ElementType::Halfedge, name, default_value);
+}
+template <typename T>
+HalfedgeAttachment<T> *SurfaceMesh::halfedge_property(const std::string &name)
+{
+    return get_property<HalfedgeAttachment, T>(ElementType::Halfedge, name);
+}
+
+template <typename T>
+EdgeAttachment<T> &SurfaceMesh::add_edge_property(const std::string &name)
+{
+    return add_property<EdgeAttachment, T>(ElementType::Edge, name);
+}
+template <typename T>
+EdgeAttachment<T> &SurfaceMesh::add_edge_property(const std::string &name, const T &default_value)
+{
+    return add_property<EdgeAttachment, T>(ElementType::Edge, name, default_value);
+}
+template <typename T>
+EdgeAttachment<T> *SurfaceMesh::edge_property(const std::string &name)
+{
+    return get_property<EdgeAttachment, T>(ElementType::Edge, name);
+}
+
+template <typename T>
+FaceAttachment<T> &SurfaceMesh::add_face_property(const std::string &name)
+{
+    return add_property<FaceAttachment, T>(ElementType::Face, name);
+}
+template <typename T>
+FaceAttachment<T> &SurfaceMesh::add_face_property(const std::string &name, const T &default_value)
+{
+    return add_property<FaceAttachment, T>(ElementType::Face, name, default_value);
+}
+template <typename T>
+FaceAttachment<T> *SurfaceMesh::face_property(const std::string &name)
+{
+    return get_property<FaceAttachment, T>(ElementType::Face, name);
+}
+
+
+/*--------------------------------------------------------------------------------
+    Index-based traversal (the methods which are only valid when the mesh is locked).
+--------------------------------------------------------------------------------*/
+inline EdgeId SurfaceMesh::edge(HalfedgeId halfedge) const
+{
+    check_locked("halfedge->edge traversal is only valid when the mesh is locked.");
+    return EdgeId(halfedge_incidence_data.edge(halfedge.index()));
+}
+
+inline HalfedgeId SurfaceMesh::halfedge(VertexId vertex) const
+{
+    // Not valid when mesh is unlocked.
+    //   (Unlocked meshes don't have full half-edge data, so vertex->halfedge relations don't give full information for traversal.
+    //    It is simpler to just not expect valid vertex incidences, and set them up only when the mesh is locked.)
+    check_locked("vertex->halfedge traversal is only valid when the mesh is locked.");
+    return HalfedgeId(vertex_incidence_data[vertex].halfedge_index);
+}
+
+inline bool SurfaceMesh::on_boundary(VertexId vertex) const
+{
+    check_locked("Vertex::on_boundary() is only valid when the mesh is locked.");
+    return vertex_on_boundary[vertex] != 0;
+}
+
+inline UncheckedTraversal SurfaceMesh::unchecked() const
+{
+    check_locked("unchecked traversal is only valid when the mesh is locked.");
+    return UncheckedTraversal(*this);
+}
+
+inline UncheckedTraversal::UncheckedTraversal(const SurfaceMesh &mesh) :
+    halfedge_incidence(mesh.halfedge_incidence_data.view()),
+    vertex_incidence{mesh.vertex_incidence_data.data_pointer()},
+    edge_incidence{mesh.edge_incidence_data.data_pointer()},
+    face_incidence{mesh.face_incidence_data.data_pointer()},
+    vertex_on_boundary{mesh.vertex_on_boundary.data_pointer()}
+{}
+
+
+/*--------------------------------------------------------------------------------
+    Element handle traversal.
+    These are thin wrappers over the index-based traversal methods of SurfaceMesh.
+--------------------------------------------------------------------------------*/
+inline Halfedge Vertex::halfedge() const
+{
+    return Halfedge(*mesh, mesh->halfedge(id()));
+}
+inline size_t Vertex::num_adjacent_vertices() const
+{
+    return mesh->num_adjacent_vertices(id());
+}
+inline bool Vertex::on_boundary() const
+{
+    return mesh->on_boundary(id());
+}
+
+inline Halfedge Halfedge::next() const
+{
+    return Halfedge(*mesh, mesh->next(id()));
+}
+inline Halfedge Halfedge::twin() const
+{
+    return Halfedge(*mesh, mesh->twin(id()));
+}
+inline Vertex Halfedge::vertex() const
+{
+    return Vertex(*mesh, mesh->vertex(id()));
+}
+inline Vertex Halfedge::tip() const
+{
+    return Vertex(*mesh, mesh->tip(id()));
+}
+inline Face Halfedge::face() const
+{
+    return Face(*mesh, mesh->face(id()));
+}
+inline Edge Halfedge::edge() const
+{
+    return Edge(*mesh, mesh->edge(id()));
+}
+
+inline Halfedge Face::halfedge() const
+{
+    return Halfedge(*mesh, mesh->halfedge(id()));
+}
+inline size_t Face::num_vertices() const
+{
+    return mesh->num_face_vertices(id());
+}
+
+inline Halfedge Edge::a() const
+{
+    return Halfedge(*mesh, mesh->halfedge_a(id()));
+}
+inline Halfedge Edge::b() const
+{
+    return Halfedge(*mesh, mesh->halfedge_b(id()));
+}
+inline bool Edge::on_boundary() const
+{
+    return mesh->on_boundary(id());
+}
+
 
 /*--------------------------------------------------------------------------------
     Element iterators.
 These iterators are simple wrappers to ElementPoolIterator that augment the iterated type.
 --------------------------------------------------------------------------------*/
 template <typename T>
-ElementIterator<T>::ElementIterator(SurfaceMesh *_mesh, ElementPool *_element_pool, ElementIndex _element_index) :
+ElementIterator<T>::ElementIterator(SurfaceMesh *_mesh, ElementPoolIterator _element_pool_iterator) :
     mesh{_mesh},
-    element_pool_iterator(_element_pool, _element_index)
+    element_pool_iterator(_element_pool_iterator)
 {}
 
 template <typename T>
-T ElementIterator<T>::operator*()
+inline T ElementIterator<T>::operator*()
 {
     return T(*mesh, *element_pool_iterator);
 }
 
 template <typename T>
-ElementIterator<T> &ElementIterator<T>::operator++()
+inline ElementIterator<T> &ElementIterator<T>::operator++()
 {
     ++element_pool_iterator;
     return *this;
 }
 
 template <typename T>
-bool ElementIterator<T>::operator==(const ElementIterator &other) const
+inline bool ElementIterator<T>::operator==(const ElementIterator &other) const
 {
     return element_pool_iterator == other.element_pool_iterator;
 }
 
 template <typename T>
-bool ElementIterator<T>::operator!=(const ElementIterator &other) const
+inline bool ElementIterator<T>::operator!=(const ElementIterator &other) const
 {
     return !operator==(other);
 }
@@ -0,0 +1,65 @@
+#ifndef VERTEX_PAIR_MAP_H
+#define VERTEX_PAIR_MAP_H
+/*--------------------------------------------------------------------------------
+    VertexPairMap
+    Open-addressing hash map from ordered pairs of element indices (u, v) to an element index.
+    This is used by SurfaceMesh to find the halfedge u->v.
+
+    The table is a flat array of 12-byte slots {u, v, value} with linear probing, so a lookup
+    touches one or two cache lines and there is no per-entry allocation (unlike the std::map
+    this replaces, which cost a ~64-byte node and a pointer chase per tree level).
+    Removal uses backward-shift deletion, so there are no tombstones and lookups do not degrade
+    after many removals.
+--------------------------------------------------------------------------------*/
+
+class VertexPairMap {
+public:
+    VertexPairMap();
+
+    // Returns InvalidElementIndex if there is no entry for (u, v).
+    inline ElementIndex find(ElementIndex u, ElementIndex v) const {
+        if (m_size == 0) return InvalidElementIndex;
+        size_t i = slot_index(u, v);
+        while (true) {
+            const Slot &slot = m_slots[i];
+            if (slot.u == u && slot.v == v) return slot.value;
+            if (slot.u == InvalidElementIndex) return InvalidElementIndex;
+            i = (i + 1) & m_mask;
+        }
+    }
+    // Insert an entry, or overwrite the value if (u, v) is already in the map.
+    void insert(ElementIndex u, ElementIndex v, ElementIndex value);
+    // Returns false if there was no entry for (u, v).
+    bool erase(ElementIndex u, ElementIndex v);
+
+    // Make sure that n entries can be stored without rehashing.
+    void reserve(size_t n);
+    void clear();
+    // Rehash into the fewest slots which hold the entries without exceeding the maximum load.
+    void shrink_to_fit();
+
+    inline size_t size() const { return m_size; }
+    inline size_t num_slots() const { return m_slots.size(); }
+    inline size_t allocated_bytes() const { return m_slots.capacity() * sizeof(Slot); }
+    inline size_t used_bytes() const { return m_size * sizeof(Slot); }
+private:
+    struct Slot {
+        ElementIndex u; // u == InvalidElementIndex marks an empty slot.
+        ElementIndex v;
+        ElementIndex value;
+    };
+    std::vector<Slot> m_slots; // The number of slots is zero or a power of two.
+    size_t m_mask;
+    unsigned int m_shift;
+    size_t m_size;
+
+    // Fibonacci hashing of the packed 64-bit key. The high bits of the product are well mixed,
+    // which matters since halfedge vertex indices are highly regular (u, u+1, u+width, ...).
+    inline size_t slot_index(ElementIndex u, ElementIndex v) const {
+        uint64_t key = (uint64_t(u) << 32) | uint64_t(v);
+        return size_t((key * 0x9E3779B97F4A7C15ull) >> m_shift);
+    }
+    void rehash(size_t new_num_slots);
+};
+
+#endif // VERTEX_PAIR_MAP_H
@@ -0,0 +1,83 @@
+#ifndef MESH_PROCESSING_TRACE_H
+#define MESH_PROCESSING_TRACE_H
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <vector>
+/*--------------------------------------------------------------------------------
+    Trace
+    Scoped timers around the phases of the library's bulk operations (lock(), subdivision, export, tetgen and I/O).
+    usage:
+        Trace::set_mode(Trace::Mode::Counters);
+        mesh.lock();
+        Trace::printout(); // Count and time of each named scope.
+
+        Trace::set_mode(Trace::Mode::Chrome);
+        ...
+        Trace::write_chrome_trace("trace.json"); // Open in chrome://tracing or https://ui.perfetto.dev.
+
+    The mode is Silent by default, where a scope costs one relaxed atomic load and a branch.
+    Scope names must be string literals (or otherwise live until the results are read), since only the pointer is kept.
+    Scopes can be opened on any thread, including inside Parallel loops.
+--------------------------------------------------------------------------------*/
+namespace Trace {
+
+enum class Mode {
+    Silent,   // Nothing is recorded.
+    Counters, // The count and the total, least and greatest duration of each scope name.
+    Chrome,   // Every scope is kept as a Chrome trace event (and is counted too).
+};
+void set_mode(Mode mode);
+extern std::atomic<Mode> g_mode; // Read inline by Scope, so that a silent scope is not a function call.
+inline Mode mode() { return g_mode.load(std::memory_order_relaxed); }
+
+struct Counter {
+    std::string name;
+    size_t count;
+    double total_seconds;
+    double min_seconds;
+    double max_seconds;
+};
+// The counters of each scope name, in the order the names were first recorded.
+std::vector<Counter> counters();
+// Print the counters as a table.
+void printout();
+// Write the events recorded in Chrome mode as trace-event JSON. Returns false if the file could not be written.
+bool write_chrome_trace(const std::string &filename);
+// Discard the recorded counters and events.
+void reset();
+
+
+typedef std::chrono::steady_clock Clock;
+void record(const char *name, Clock::time_point start, Clock::time_point end);
+
+// Times the enclosing scope.
+// usage:
+//     Trace::Scope trace("Subdivision::loop");
+// A sequence of phases can be timed with one scope, with next() ending the current phase and starting the next.
+class Scope {
+public:
+    inline explicit Scope(const char *name) : m_name{name}, m_enabled{mode() != Mode::Silent} {
+        if (m_enabled) m_start = Clock::now();
+    }
+    inline ~Scope() {
+        if (m_enabled) record(m_name, m_start, Clock::now());
+    }
+    inline void next(const char *name) {
+        if (m_enabled) {
+            auto now = Clock::now();
+            record(m_name, m_start, now);
+            m_start = now;
+        }
+        m_name = name;
+    }
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+private:
+    const char *m_name;
+    bool m_enabled;
+    Clock::time_point m_start;
+};
+
+}; // namespace Trace
+#endif // MESH_PROCESSING_TRACE_H
@@ -3,6 +3,7 @@
 // Construct a simple triangle list from a SurfaceGeometry (vertex positions attached to a SurfaceMesh).
 CompactTriangleMesh::CompactTriangleMesh(SurfaceGeometry &geom)
 {
+    Trace::Scope trace("CompactTriangleMesh");
     assert(geom.mesh.is_triangular());
 
     m_num_vertices = geom.mesh.num_vertices();
@@ -10,27 +11,32 @@ CompactTriangleMesh::CompactTriangleMesh(SurfaceGeometry &geom)
     m_position_data = Eigen::MatrixXf(m_num_vertices, 3);
     m_triangle_data = Eigen::MatrixXi(m_num_triangles, 3);
 
+    // The positions are copied a run of active vertices at a time (one run if no vertices have been removed).
     int vertex_index = 0;
+    AttachmentMap::for_each_block(geom.position, [&](AttachmentMap::Map<vec_t> block, ElementIndex) {
+        m_position_data.middleRows(vertex_index, block.cols()) = block.transpose();
+        vertex_index += block.cols();
+    });
+    // The contiguous indices are counted serially, then the triangle rows are filled in parallel.
+    vertex_index = 0;
     VertexAttachment<int> contiguous_vertex_indices(geom.mesh);
     for (auto v : geom.mesh.vertices()) {
-        m_position_data.row(vertex_index) = geom.position[v];
         contiguous_vertex_indices[v] = vertex_index;
         vertex_index += 1;
     }
-    
-    size_t face_index = 0;
+    int face_index = 0;
+    FaceAttachment<int> contiguous_face_indices(geom.mesh);
     for (auto face : geom.mesh.faces()) {
-        auto he = face.halfedge();
-        int index_a = contiguous_vertex_indices[he.vertex()];
-        he = he.next();
-        int index_b = contiguous_vertex_indices[he.vertex()];
-        he = he.next();
-        int index_c = contiguous_vertex_indices[he.vertex()];
-        m_triangle_data(face_index, 0) = index_a;
-        m_triangle_data(face_index, 1) = index_b;
-        m_triangle_data(face_index, 2) = index_c;
+        contiguous_face_indices[face] = face_index;
         face_index += 1;
     }
+    geom.mesh.faces().parallel_for([&](Face face) {
+        auto verts = face.triangle_vertices();
+        int row = contiguous_face_indices[face];
+        m_triangle_data(row, 0) = contiguous_vertex_indices[verts[0]];
+        m_triangle_data(row, 1) = contiguous_vertex_indices[verts[1]];
+        m_triangle_data(row, 2) = contiguous_vertex_indices[verts[2]];
+    });
 }
 
 vec_t CompactTriangleMesh::position(size_t vertex_index) const
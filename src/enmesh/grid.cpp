@@ -5,36 +5,42 @@ namespace Enmesh {
 /*
  * x_nodes-by-y_nodes grid, with two triangles per quad.
  * x_nodes is the number of horizontal nodes. There will be x_nodes-1 horizontal intervals.
+ * The node at column i and row j is the vertex with index x_nodes*j + i.
  */
-SurfaceMesh grid_mesh(int x_nodes, int y_nodes)
+void grid_mesh(SurfaceMesh &mesh, int x_nodes, int y_nodes)
 {
     assert(x_nodes > 1 && y_nodes > 1);
-    auto mesh = SurfaceMesh();
-    std::vector<Vertex> grid_vertices(x_nodes * y_nodes);
-    for (int i = 0; i < x_nodes; i++) {
-        for (int j = 0; j < y_nodes; j++) {
-            grid_vertices[x_nodes*j + i] = mesh.add_vertex();
-        }
-    }
+    assert(mesh.num_vertices() == 0);
+    // Reserve for the locked mesh, including the 2*(x_nodes-1) + 2*(y_nodes-1) boundary halfedges.
+    size_t num_faces = 2 * size_t(x_nodes-1) * (y_nodes-1);
+    mesh.reserve(x_nodes * y_nodes, 3*num_faces + 2*(x_nodes-1) + 2*(y_nodes-1), num_faces);
+    ElementIndex first_vertex = mesh.add_vertices(x_nodes * y_nodes);
+    auto triangles = std::vector<ElementIndex>();
+    triangles.reserve(6 * (x_nodes-1) * (y_nodes-1));
     for (int i = 0; i < x_nodes-1; i++) {
         for (int j = 0; j < y_nodes-1; j++) {
-            auto &bl = grid_vertices[x_nodes*j + i];
-            auto &br = grid_vertices[x_nodes*j + i+1];
-            auto &tr = grid_vertices[x_nodes*(j+1) + i+1];
-            auto &tl = grid_vertices[x_nodes*(j+1) + i];
-            mesh.add_triangle(bl, br, tr);
-            mesh.add_triangle(bl, tr, tl);
+            ElementIndex bl = first_vertex + x_nodes*j + i;
+            ElementIndex br = first_vertex + x_nodes*j + i+1;
+            ElementIndex tr = first_vertex + x_nodes*(j+1) + i+1;
+            ElementIndex tl = first_vertex + x_nodes*(j+1) + i;
+            ElementIndex quad_triangles[6] = {bl, br, tr, bl, tr, tl};
+            triangles.insert(triangles.end(), quad_triangles, quad_triangles+6);
         }
     }
+    mesh.add_faces(triangles.data(), triangles.size() / 3, 3);
+}
+
+SurfaceMesh *grid_mesh(int x_nodes, int y_nodes)
+{
+    auto mesh = new SurfaceMesh();
+    grid_mesh(*mesh, x_nodes, y_nodes);
     return mesh;
 }
 
-SurfaceGeometry grid_geom(int x_nodes, int y_nodes, float bl_x, float bl_y, float tr_x, float tr_y)
+SurfaceGeometry *grid_geom(SurfaceMesh &mesh, int x_nodes, int y_nodes, float bl_x, float bl_y, float tr_x, float tr_y)
 {
-    assert(x_nodes > 1 && y_nodes > 1);
-    // auto geom = SurfaceGeometry(grid_mesh(x_nodes, y_nodes)); ---todo: Geometry from mesh
-    auto geom = SurfaceGeometry();
-    std::vector<Vertex> grid_vertices(x_nodes * y_nodes);
+    grid_mesh(mesh, x_nodes, y_nodes);
+    auto geom = new SurfaceGeometry(mesh);
 
     float inv_x = 1.f / (x_nodes - 1);
     float inv_y = 1.f / (y_nodes - 1);
@@ -42,17 +48,7 @@ SurfaceGeometry grid_geom(int x_nodes, int y_nodes, float bl_x, float bl_y, floa
         for (int j = 0; j < y_nodes; j++) {
             float tx = i * inv_x;
             float ty = j * inv_y;
-            grid_vertices[x_nodes*j + i] = geom.add_vertex((1-tx)*bl_x + tx*tr_x, (1-ty)*bl_y + ty*tr_y, 0);
-        }
-    }
-    for (int i = 0; i < x_nodes-1; i++) {
-        for (int j = 0; j < y_nodes-1; j++) {
-            auto &bl = grid_vertices[x_nodes*j + i];
-            auto &br = grid_vertices[x_nodes*j + i+1];
-            auto &tr = grid_vertices[x_nodes*(j+1) + i+1];
-            auto &tl = grid_vertices[x_nodes*(j+1) + i];
-            geom.mesh.add_triangle(bl, br, tr);
-            geom.mesh.add_triangle(bl, tr, tl);
+            geom->position[Vertex(geom->mesh, x_nodes*j + i)] = vec_t((1-tx)*bl_x + tx*tr_x, (1-ty)*bl_y + ty*tr_y, 0);
         }
     }
     return geom;
@@ -5,6 +5,7 @@ namespace Enmesh {
 
 void save_geometry(SurfaceGeometry &geom, const std::string &filename)
 {
+    Trace::Scope trace("Enmesh::save_geometry");
     assert(geom.mesh.is_triangular());
 
     std::ofstream out;
@@ -25,14 +26,10 @@ void save_geometry(SurfaceGeometry &geom, const std::string &filename)
         index ++;
     }
     for (auto face : geom.mesh.faces()) {
-        std::cout << "3 "; //---triangular mesh
-        auto start = face.halfedge();
-        auto he = start;
-        do {
-            uint32_t vertex_index = vertex_indices[he.vertex()];
-            out << std::to_string(vertex_index) << " ";
-            he = he.next();
-        } while (start != he);
+        out << "3 "; //---triangular mesh
+        for (auto v : face.vertices()) {
+            out << std::to_string(vertex_indices[v]) << " ";
+        }
         out << "\n";
     }
 
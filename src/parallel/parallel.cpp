@@ -0,0 +1,257 @@
+#include "mesh_processing/mesh_processing.h"
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <memory>
+namespace Parallel {
+
+static unsigned int g_num_threads = 0;
+static size_t g_grain_size = 4096;
+
+void set_num_threads(unsigned int num_threads)
+{
+    g_num_threads = num_threads;
+}
+
+unsigned int num_threads()
+{
+    if (g_num_threads > 0) return g_num_threads;
+    return std::max(1u, std::thread::hardware_concurrency());
+}
+
+void set_grain_size(size_t grain_size)
+{
+    g_grain_size = std::max<size_t>(grain_size, 1);
+}
+
+size_t grain_size()
+{
+    return g_grain_size;
+}
+
+
+/*--------------------------------------------------------------------------------
+    ThreadPool
+    Runs one job at a time, where a job is a function called for each of a number of chunk indices.
+    Each thread (the workers and the calling thread) has a queue of chunks, which is a range of chunk indices
+    packed into one 64-bit word: the owner takes chunks from the front, and thieves take the back half,
+    each with a single compare-exchange.
+--------------------------------------------------------------------------------*/
+namespace {
+
+// True on pool threads while they run a job, and on the calling thread while it waits for one.
+thread_local bool t_in_parallel = false;
+
+inline uint64_t pack_range(uint32_t begin, uint32_t end) { return (uint64_t(begin) << 32) | end; }
+inline uint32_t range_begin(uint64_t range) { return uint32_t(range >> 32); }
+inline uint32_t range_end(uint64_t range) { return uint32_t(range); }
+
+// Padded to a cache line, so that threads taking from their own queues don't contend.
+// (Not alignas(64), since C++14 new doesn't support over-aligned types.)
+struct ChunkQueue {
+    std::atomic<uint64_t> range;
+    char padding[64 - sizeof(std::atomic<uint64_t>)];
+};
+
+class ThreadPool {
+public:
+    ThreadPool() : m_generation{0}, m_stopping{false}, m_job{nullptr}, m_num_busy{0} {}
+    ~ThreadPool() { stop(); }
+
+    // Call function(chunk) for each chunk in [0, num_chunks), on num_threads threads (including the calling thread).
+    void run(size_t num_chunks, unsigned int num_threads, const std::function<void(size_t)> &function);
+
+    // The calling thread can take part in one job at a time.
+    std::mutex job_mutex;
+private:
+    void start(unsigned int num_workers);
+    void stop();
+    void worker_main(unsigned int queue_index, uint64_t generation);
+    void work(unsigned int queue_index);
+    bool take(unsigned int queue_index, size_t &chunk);
+    bool steal(unsigned int queue_index);
+
+    std::vector<std::thread> m_workers;
+    std::unique_ptr<ChunkQueue[]> m_queues; // One for each worker, then one for the calling thread.
+    unsigned int m_num_queues;
+
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    uint64_t m_generation; // Incremented for each job.
+    bool m_stopping;
+    const std::function<void(size_t)> *m_job;
+    unsigned int m_num_busy; // The number of workers which haven't finished the current job.
+};
+
+void ThreadPool::start(unsigned int num_workers)
+{
+    m_num_queues = num_workers + 1;
+    m_queues.reset(new ChunkQueue[m_num_queues]);
+    for (unsigned int i = 0; i < m_num_queues; i++) m_queues[i].range.store(0);
+    m_stopping = false;
+    for (unsigned int i = 0; i < num_workers; i++) {
+        m_workers.emplace_back(&ThreadPool::worker_main, this, i, m_generation);
+    }
+}
+
+void ThreadPool::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_wake.notify_all();
+    for (auto &worker : m_workers) {
+        worker.join();
+    }
+    m_workers.clear();
+}
+
+void ThreadPool::run(size_t num_chunks, unsigned int num_threads, const std::function<void(size_t)> &function)
+{
+    assert(num_chunks < (size_t(1) << 32));
+    if (m_workers.size() + 1 != num_threads) {
+        // The thread count has changed (or this is the first job).
+        stop();
+        start(num_threads - 1);
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        // Give each thread a contiguous share of the chunks.
+        for (unsigned int i = 0; i < m_num_queues; i++) {
+            m_queues[i].range.store(pack_range(uint32_t(num_chunks * i / m_num_queues), uint32_t(num_chunks * (i + 1) / m_num_queues)));
+        }
+        m_job = &function;
+        m_num_busy = unsigned(m_workers.size());
+        m_generation += 1;
+    }
+    m_wake.notify_all();
+    work(m_num_queues - 1);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [&]() { return m_num_busy == 0; });
+    m_job = nullptr;
+}
+
+// generation is that of the last job before the worker started.
+void ThreadPool::worker_main(unsigned int queue_index, uint64_t generation)
+{
+    t_in_parallel = true;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [&]() { return m_stopping || m_generation != generation; });
+            if (m_stopping) return;
+            generation = m_generation;
+        }
+        work(queue_index);
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (--m_num_busy == 0) m_done.notify_one();
+        }
+    }
+}
+
+void ThreadPool::work(unsigned int queue_index)
+{
+    size_t chunk;
+    while (take(queue_index, chunk) || (steal(queue_index) && take(queue_index, chunk))) {
+        (*m_job)(chunk);
+    }
+}
+
+// Take the first chunk of this thread's queue.
+bool ThreadPool::take(unsigned int queue_index, size_t &chunk)
+{
+    auto &range = m_queues[queue_index].range;
+    uint64_t current = range.load();
+    while (range_begin(current) < range_end(current)) {
+        if (range.compare_exchange_weak(current, pack_range(range_begin(current) + 1, range_end(current)))) {
+            chunk = range_begin(current);
+            return true;
+        }
+    }
+    return false;
+}
+
+// Move the back half of another thread's chunks to this thread's (empty) queue. Returns false if there were none left.
+bool ThreadPool::steal(unsigned int queue_index)
+{
+    for (unsigned int k = 1; k < m_num_queues; k++) {
+        auto &victim = m_queues[(queue_index + k) % m_num_queues].range;
+        uint64_t current = victim.load();
+        while (range_begin(current) < range_end(current)) {
+            uint32_t begin = range_begin(current);
+            uint32_t end = range_end(current);
+            uint32_t middle = begin + (end - begin) / 2;
+            if (victim.compare_exchange_weak(current, pack_range(begin, middle))) {
+                // Nothing takes from an empty queue, so this store doesn't race with the owner.
+                m_queues[queue_index].range.store(pack_range(middle, end));
+                return true;
+            }
+        }
+    }
+    return false;
+}
+
+ThreadPool &thread_pool()
+{
+    static ThreadPool pool;
+    return pool;
+}
+
+// Run the job on the pool, or serially if this is inside another parallel call (or another thread is using the pool).
+void run(size_t num_chunks, const std::function<void(size_t)> &function)
+{
+    unsigned int threads = std::min<size_t>(num_threads(), num_chunks);
+    auto &pool = thread_pool();
+    if (threads > 1 && !t_in_parallel && pool.job_mutex.try_lock()) {
+        t_in_parallel = true;
+        pool.run(num_chunks, num_threads(), function);
+        t_in_parallel = false;
+        pool.job_mutex.unlock();
+        return;
+    }
+    for (size_t chunk = 0; chunk < num_chunks; chunk++) {
+        function(chunk);
+    }
+}
+
+} // namespace
+
+
+void for_range(size_t begin, size_t end, const std::function<void(size_t, size_t)> &function, size_t grain_size)
+{
+    if (end <= begin) return;
+    size_t n = end - begin;
+    size_t grain = grain_size > 0 ? grain_size : g_grain_size;
+    // Chunks are at least the grain size. There are a few per thread, so that there is work to steal
+    // if some chunks take longer than others.
+    size_t num_chunks = std::min<size_t>(8 * num_threads(), (n + grain - 1) / grain);
+    if (num_chunks <= 1) {
+        function(begin, end);
+        return;
+    }
+    run(num_chunks, [&](size_t chunk) {
+        function(begin + n * chunk / num_chunks, begin + n * (chunk + 1) / num_chunks);
+    });
+}
+
+
+void for_chunks(size_t begin, size_t end, size_t num_chunks, const std::function<void(size_t, size_t, size_t)> &function)
+{
+    if (end < begin) end = begin;
+    size_t n = end - begin;
+    run(num_chunks, [&](size_t chunk) {
+        function(chunk, begin + n * chunk / num_chunks, begin + n * (chunk + 1) / num_chunks);
+    });
+}
+
+size_t default_num_chunks(size_t n, size_t grain_size)
+{
+    return std::max<size_t>(1, std::min<size_t>(4 * num_threads(), n / std::max<size_t>(grain_size, 1)));
+}
+
+}; // namespace Parallel
@@ -7,33 +7,47 @@ Triangular::Triangular(SurfaceMesh &_original_mesh) :
     m_edge_split_vertex(_original_mesh),
     m_vertex_to_vertex(_original_mesh)
 {
+    Trace::Scope trace("Subdivision::Triangular");
     assert(original_mesh().locked());
     assert(original_mesh().is_triangular());
 
+    // Each face is split into four triangles, and each boundary halfedge into two, so the sizes of the
+    // subdivided mesh (including the boundary halfedges added by lock()) are known up front.
+    size_t num_vertices = original_mesh().num_vertices() + original_mesh().num_edges();
+    size_t num_faces = 4 * original_mesh().num_faces();
+    size_t num_halfedges = 2 * original_mesh().num_halfedges() + 6 * original_mesh().num_faces();
+    mesh().reserve(num_vertices, num_halfedges, num_faces);
+
+    // Add all vertices at once. These have contiguous indices, given to the original vertices and then the edges.
+    ElementIndex next_vertex = mesh().add_vertices(num_vertices);
     for (auto v : original_mesh().vertices()) {
-        m_vertex_to_vertex[v] = mesh().add_vertex();
+        m_vertex_to_vertex[v] = VertexId(next_vertex++);
     }
     for (auto edge : original_mesh().edges()) {
-        m_edge_split_vertex[edge] = mesh().add_vertex();
+        m_edge_split_vertex[edge] = VertexId(next_vertex++);
     }
 
+    std::vector<ElementIndex> triangles;
+    triangles.reserve(3 * num_faces);
     for (auto face : original_mesh().faces()) {
         // Add the three outer triangles.
-        auto start = face.halfedge();
-        auto he = start;
-        Vertex center_triangle_vertices[3];
-        int i = 0;
-        do {
-            auto vertex1 = m_edge_split_vertex[he.edge()];
-            auto vertex2 = m_vertex_to_vertex[he.next().vertex()];
-            auto vertex3 = m_edge_split_vertex[he.next().edge()];
-            mesh().add_triangle(vertex1, vertex2, vertex3);
-            center_triangle_vertices[i] = vertex1;
-            i ++;
-        } while ((he = he.next()) != start);
+        auto halfedges = face.triangle_halfedges();
+        ElementIndex center_triangle_vertices[3];
+        for (int i = 0; i < 3; i++) {
+            auto he = halfedges[i];
+            auto next = halfedges[(i + 1) % 3];
+            ElementIndex outer_triangle_vertices[3] = {
+                m_edge_split_vertex[he.edge()].index(),
+                m_vertex_to_vertex[next.vertex()].index(),
+                m_edge_split_vertex[next.edge()].index()
+            };
+            triangles.insert(triangles.end(), outer_triangle_vertices, outer_triangle_vertices+3);
+            center_triangle_vertices[i] = outer_triangle_vertices[0];
+        }
         // Add center triangle.
-        mesh().add_face(center_triangle_vertices, 3);
+        triangles.insert(triangles.end(), center_triangle_vertices, center_triangle_vertices+3);
     }
+    mesh().add_faces(triangles.data(), triangles.size() / 3, 3);
     mesh().lock();
 }
 
@@ -44,51 +58,57 @@ SurfaceGeometry *loop(Triangular &subdiv, SurfaceGeometry &geom)
     // Input: A Subdivision::Triangular instance, topologically subdividing a mesh.
     //        A SurfaceGeometry giving vertex positions for the original mesh (the one subdivided).
     // Returns: A SurfaceGeometry for the subdivided mesh, with vertex positions given by the Loop subdivision rules.
+    Trace::Scope trace("Subdivision::loop");
     assert(&subdiv.original_mesh() == &geom.mesh);
     SurfaceMesh &original_mesh = subdiv.original_mesh();
 
     auto subdiv_geom = new SurfaceGeometry(subdiv.mesh());
-    // Compute positions of vertex points.
-    for (auto v : original_mesh.vertices()) {
-        size_t n = v.num_adjacent_vertices();
+    // The mesh is locked and is not edited here, so the traversal and position accesses are unchecked.
+    auto traversal = original_mesh.unchecked();
+    const vec_t *position = geom.position.data_pointer();
+    vec_t *subdiv_position = subdiv_geom->position.data_pointer();
+    // Compute positions of vertex points. Each vertex and edge writes only its own subdivided vertex, so these run in parallel.
+    original_mesh.vertices().parallel_for([&](Vertex v) {
+        size_t n = traversal.num_adjacent_vertices(v.id());
         float _c = 3+ 2*cos(2*M_PI/n);
         float beta = (5.f/8.f - (_c*_c)/64.f)/n;
         float original_weight = 1-n*beta;
         float neighbour_weight = beta;
-        vec_t pos = original_weight * geom.position[v];
-        auto start = v.halfedge();
-        auto he = start;
-        do {
-            pos += neighbour_weight * geom.position[he.twin().vertex()];
-        } while ((he = he.twin().next()) != start);
-        subdiv_geom->position[subdiv.corresponding_vertex(v)] = pos;
-    }
+        vec_t pos = original_weight * position[v.index()];
+        for (auto neighbour : traversal.one_ring(v.id())) {
+            pos += neighbour_weight * position[neighbour.index()];
+        }
+        subdiv_position[subdiv.corresponding_vertex(v.id()).index()] = pos;
+    });
     // Compute positions of new edge points.
-    for (auto edge : original_mesh.edges()) {
-        auto end_a = geom.position[edge.a().vertex()];
-        auto end_b = geom.position[edge.b().vertex()];
-        auto wing_a = geom.position[edge.a().next().next().vertex()];
-        auto wing_b = geom.position[edge.b().next().next().vertex()];
+    original_mesh.edges().parallel_for([&](Edge edge) {
+        auto a = traversal.halfedge_a(edge.id());
+        auto b = traversal.halfedge_b(edge.id());
+        auto end_a = position[traversal.vertex(a).index()];
+        auto end_b = position[traversal.vertex(b).index()];
+        auto wing_a = position[traversal.vertex(traversal.next(traversal.next(a))).index()];
+        auto wing_b = position[traversal.vertex(traversal.next(traversal.next(b))).index()];
         vec_t pos = (1.0/8.0)*wing_a + (1.0/8.0)*wing_b + (3.0/8.0)*end_a + (3.0/8.0)*end_b;
-        subdiv_geom->position[subdiv.edge_split_vertex(edge)] = pos;
-    }
+        subdiv_position[subdiv.edge_split_vertex(edge.id()).index()] = pos;
+    });
     return subdiv_geom;
 }
 
 SurfaceGeometry *barycentric(Triangular &subdiv, SurfaceGeometry &geom)
 {
     // Barycentric subdivision.
+    Trace::Scope trace("Subdivision::barycentric");
     assert(&subdiv.original_mesh() == &geom.mesh);
     SurfaceMesh &original_mesh = subdiv.original_mesh();
 
     auto subdiv_geom = new SurfaceGeometry(subdiv.mesh());
-    for (auto v : original_mesh.vertices()) {
+    original_mesh.vertices().parallel_for([&](Vertex v) {
         subdiv_geom->position[subdiv.corresponding_vertex(v)] = geom.position[v];
-    }
-    for (auto edge : geom.mesh.edges()) {
+    });
+    original_mesh.edges().parallel_for([&](Edge edge) {
         vec_t pos = 0.5*geom.position[edge.a().vertex()] + 0.5*geom.position[edge.b().vertex()];
         subdiv_geom->position[subdiv.edge_split_vertex(edge)] = pos;
-    }
+    });
     return subdiv_geom;
 }
 
@@ -1,17 +1,11 @@
 #include "mesh_processing/mesh_processing.h"
+#include <tuple>
 
 
 float SurfaceGeometry::triangle_area(Face tri) const
 {
     assert(tri.num_vertices() == 3);
-    Vertex verts[3];
-    int vertex_index = 0;
-    auto he = tri.halfedge();
-    do {
-        he = he.next();
-        verts[vertex_index] = he.vertex();
-    } while (++vertex_index < 3);
-
+    auto verts = tri.triangle_vertices();
     auto A = position[verts[0]];
     auto B = position[verts[1]];
     auto C = position[verts[2]];
@@ -23,14 +17,11 @@ vec_t SurfaceGeometry::barycenter(Face face) const
 {
     vec_t avg = vec_t(0,0,0);
 
-    auto start = face.halfedge();
-    auto he = start;
     int num_vertices = 0;
-    do {
-        avg += position[he.vertex()];
+    for (auto v : face.vertices()) {
+        avg += position[v];
         num_vertices += 1;
-        he = he.next();
-    } while (he != start);
+    }
     avg /= num_vertices;
     return avg;
 }
@@ -38,9 +29,10 @@ vec_t SurfaceGeometry::barycenter(Face face) const
 vec_t SurfaceGeometry::triangle_normal(Face tri) const
 {
     assert(tri.num_vertices() == 3);
-    vec_t A = position[tri.halfedge().vertex()];
-    vec_t B = position[tri.halfedge().next().vertex()];
-    vec_t C = position[tri.halfedge().next().next().vertex()];
+    auto verts = tri.triangle_vertices();
+    vec_t A = position[verts[0]];
+    vec_t B = position[verts[1]];
+    vec_t C = position[verts[2]];
     vec_t n = (B-A).cross(C-A);
     return n / n.norm();
 }
@@ -60,16 +52,154 @@ vec_t SurfaceGeometry::vector(Halfedge he) const
 }
 
 
-// SurfaceGeometry::SurfaceGeometry(CompactTriangleMesh &tris)
-// {
-//     for (int i = 0; i < tris.num_vertices(); i++) {
-//         auto v = mesh.add_vertex();
-//         position[v] = tris.position[i];
-//     }
-//     for (int i = 0; i < tris.num_faces(); i++) {
-//         auto a = Vertex(tris.triangle_vertex_index(i, 0), mesh);
-//         auto b = Vertex(tris.triangle_vertex_index(i, 0), mesh);
-//         auto c = Vertex(tris.triangle_vertex_index(i, 0), mesh); // Important: Assumption of contiguous indices.
-//         mesh.add_triangle(a, b, c);
-//     }
-// }
+typedef std::pair<vec_t, vec_t> BoundingBox;
+
+static BoundingBox empty_bounding_box()
+{
+    return {vec_t::Constant(std::numeric_limits<float>::infinity()), vec_t::Constant(-std::numeric_limits<float>::infinity())};
+}
+
+// The bounding box of n positions.
+static BoundingBox positions_bounding_box(const vec_t *positions, size_t n)
+{
+    BoundingBox box = empty_bounding_box();
+    // Eigen doesn't vectorize a reduction across the columns of a 3-row matrix, so each four positions are viewed
+    // as one column of a 12-row matrix, and the four 3-vectors of the result are folded together.
+    Eigen::Index num_packed = Eigen::Index(n / 4);
+    Eigen::Map<const Eigen::Matrix<float, 12, Eigen::Dynamic>> packed(positions[0].data(), 12, num_packed);
+    if (num_packed > 0) {
+        Eigen::Matrix<float, 12, 1> packed_min = packed.rowwise().minCoeff();
+        Eigen::Matrix<float, 12, 1> packed_max = packed.rowwise().maxCoeff();
+        for (int k = 0; k < 4; k++) {
+            box.first = box.first.cwiseMin(packed_min.segment<3>(3*k));
+            box.second = box.second.cwiseMax(packed_max.segment<3>(3*k));
+        }
+    }
+    for (size_t i = 4 * num_packed; i < n; i++) {
+        box.first = box.first.cwiseMin(positions[i]);
+        box.second = box.second.cwiseMax(positions[i]);
+    }
+    return box;
+}
+
+static BoundingBox combine_bounding_boxes(const BoundingBox &a, const BoundingBox &b)
+{
+    return {a.first.cwiseMin(b.first), a.second.cwiseMax(b.second)};
+}
+
+std::pair<vec_t, vec_t> SurfaceGeometry::bounding_box() const
+{
+    BoundingBox box = empty_bounding_box();
+    AttachmentMap::for_each_block(position, [&](AttachmentMap::ConstMap<vec_t> block, ElementIndex first_index) {
+        const vec_t *positions = position.data_pointer() + first_index;
+        BoundingBox block_box = Parallel::reduce(0, block.cols(), empty_bounding_box(), [&](size_t begin, size_t end) {
+            return positions_bounding_box(positions + begin, end - begin);
+        }, combine_bounding_boxes);
+        box = combine_bounding_boxes(box, block_box);
+    });
+    return box;
+}
+
+vec_t SurfaceGeometry::centroid() const
+{
+    if (mesh.num_vertices() == 0) return vec_t::Zero();
+    // Sum in double precision, since there can be many millions of positions.
+    // The partial sums are added in a fixed order (see Parallel::reduce), so the result doesn't depend on the thread count.
+    Eigen::Vector3d sum = Eigen::Vector3d::Zero();
+    AttachmentMap::for_each_block(position, [&](AttachmentMap::ConstMap<vec_t> block, ElementIndex) {
+        sum += Parallel::reduce(0, block.cols(), Eigen::Vector3d::Zero().eval(), [&](size_t begin, size_t end) {
+            return block.middleCols(begin, end - begin).cast<double>().rowwise().sum().eval();
+        }, [](const Eigen::Vector3d &a, const Eigen::Vector3d &b) -> Eigen::Vector3d { return a + b; });
+    });
+    return (sum / double(mesh.num_vertices())).cast<float>();
+}
+
+void SurfaceGeometry::transform(const Eigen::Affine3f &transformation)
+{
+    // The product is evaluated into a fixed-size temporary a chunk of columns at a time, rather than into
+    // a temporary the size of the mesh (which Eigen would make, since the block is on both sides).
+    const int chunk_size = 256;
+    AttachmentMap::for_each_block(position, [&](AttachmentMap::Map<vec_t> block, ElementIndex) {
+        Parallel::for_range(0, block.cols(), [&](size_t begin, size_t end) {
+            Eigen::Matrix<float, 3, chunk_size> transformed;
+            auto range = block.middleCols(begin, end - begin);
+            Eigen::Index i = 0;
+            for (; i + chunk_size <= range.cols(); i += chunk_size) {
+                auto chunk = range.middleCols<chunk_size>(i);
+                transformed.noalias() = transformation.linear().lazyProduct(chunk).colwise() + transformation.translation();
+                chunk = transformed;
+            }
+            auto rest = range.rightCols(range.cols() - i);
+            rest = (transformation.linear() * rest).colwise() + transformation.translation();
+        });
+    });
+}
+
+
+ElementIndex SurfaceGeometry::add_vertices(const float *positions, size_t num_vertices)
+{
+    ElementIndex first_vertex = mesh.add_vertices(num_vertices);
+    Parallel::for_range(0, num_vertices, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            const float *p = &positions[3*i];
+            position[Vertex(mesh, first_vertex + i)] = vec_t(p[0], p[1], p[2]);
+        }
+    });
+    return first_vertex;
+}
+
+
+// Spread the low 21 bits of x so that there are two zero bits between each bit.
+static uint64_t spread_bits_3(uint64_t x)
+{
+    x &= 0x1FFFFF;
+    x = (x | (x << 32)) & 0x1F00000000FFFFull;
+    x = (x | (x << 16)) & 0x1F0000FF0000FFull;
+    x = (x | (x << 8)) & 0x100F00F00F00F00Full;
+    x = (x | (x << 4)) & 0x10C30C30C30C30C3ull;
+    x = (x | (x << 2)) & 0x1249249249249249ull;
+    return x;
+}
+
+SurfaceMesh::ElementIndexMaps SurfaceGeometry::spatial_reorder()
+{
+    // Compute the bounding box, and quantize positions in it to 21 bits per axis.
+    vec_t box_min, box_max;
+    std::tie(box_min, box_max) = bounding_box();
+    vec_t extent = (box_max - box_min).cwiseMax(vec_t::Constant(std::numeric_limits<float>::min()));
+    vec_t scale = vec_t::Constant(float((1 << 21) - 1)).cwiseQuotient(extent);
+
+    // Sort the vertices by Morton code, breaking ties by vertex index.
+    // Each key is the 63-bit Morton code, and the vertex index is kept alongside.
+    auto keys = std::vector<std::pair<uint64_t, ElementIndex>>();
+    keys.reserve(mesh.num_vertices());
+    for (auto v : mesh.vertices()) {
+        vec_t q = (position[v] - box_min).cwiseProduct(scale).cwiseMin(vec_t::Constant(float((1 << 21) - 1)));
+        uint64_t code = spread_bits_3(uint64_t(q.x())) | (spread_bits_3(uint64_t(q.y())) << 1) | (spread_bits_3(uint64_t(q.z())) << 2);
+        keys.emplace_back(code, v.index());
+    }
+    std::sort(keys.begin(), keys.end());
+    auto vertex_order = std::vector<ElementIndex>(keys.size());
+    for (size_t i = 0; i < keys.size(); i++) {
+        vertex_order[i] = keys[i].second;
+    }
+    return mesh.reorder(vertex_order);
+}
+
+
+SurfaceGeometry::SurfaceGeometry(SurfaceMesh &_mesh, const CompactTriangleMesh &tris) :
+    mesh{_mesh},
+    position(mesh)
+{
+    ElementIndex first_vertex = mesh.add_vertices(tris.num_vertices());
+    for (size_t i = 0; i < tris.num_vertices(); i++) {
+        position[Vertex(mesh, first_vertex + i)] = tris.position(i);
+    }
+    auto triangles = std::vector<ElementIndex>(3 * tris.num_triangles());
+    for (size_t i = 0; i < tris.num_triangles(); i++) {
+        for (int k = 0; k < 3; k++) {
+            triangles[3*i + k] = first_vertex + tris.triangle_vertex_index(i, k);
+        }
+    }
+    mesh.add_faces(triangles.data(), tris.num_triangles(), 3);
+}
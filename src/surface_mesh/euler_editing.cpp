@@ -1,81 +1,159 @@
 #include "mesh_processing/mesh_processing.h"
+#include <unordered_set>
 
 
 /* Add all mesh elements of another mesh, disjointly, to this mesh.
+ * If both meshes are locked, this mesh stays locked: the added mesh's full incidence structure (including its boundary
+ * halfedges, edges and topology data) is copied, so the cost is proportional to the size of the added mesh only.
+ * Otherwise, this mesh is unlocked and the faces are added with raw editing.
  */
 void SurfaceMesh::add(SurfaceMesh &mesh)
 {
-    // assert(locked());
-    //---lock?
-    unlock();
-    
-    // To add the mesh, create a new vertex (in this mesh) for each vertex in the added mesh.
-    // Keep a vertex attachment on the added mesh, which will contain the raw indices in the list new_vertices.
-    auto vertex_indices = VertexAttachment<uint32_t>(mesh);
-    auto new_vertices = std::vector<Vertex>(mesh.num_vertices());
-    uint32_t vertex_index = 0;
+    if (!locked() || !mesh.locked()) {
+        unlock();
+
+        // To add the mesh, create a new vertex (in this mesh) for each vertex in the added mesh.
+        // Keep a vertex attachment on the added mesh, which will contain the id of the new vertex.
+        auto new_vertices = VertexAttachment<VertexId>(mesh);
+        for (auto v : mesh.vertices()) {
+            new_vertices[v] = add_vertex().id();
+        }
+
+        // To add faces, go through each face in the added mesh,
+        // and iterate over its vertices. Look up the new vertex in the vertex attachment.
+        // A list of these new vertices is formed to create a new face.
+        auto face_vertices = std::vector<Vertex>();
+        for (auto face : mesh.faces()) {
+            for (auto v : face.vertices()) {
+                face_vertices.push_back(Vertex(*this, new_vertices[v]));
+            }
+            add_face(face_vertices);
+            face_vertices.clear();
+        }
+        return;
+    }
+    invalidate_connected_components();
+
+    // Create the new elements, keeping the new id of each element on attachments of the added mesh.
+    auto new_vertices = VertexAttachment<VertexId>(mesh);
+    auto new_halfedges = HalfedgeAttachment<HalfedgeId>(mesh);
+    auto new_edges = EdgeAttachment<EdgeId>(mesh);
+    auto new_faces = FaceAttachment<FaceId>(mesh);
+    for (auto v : mesh.vertices()) new_vertices[v] = VertexId(vertex_pool.add());
+    for (auto he : mesh.halfedges()) new_halfedges[he] = HalfedgeId(halfedge_pool.add());
+    for (auto edge : mesh.edges()) new_edges[edge] = EdgeId(edge_pool.add());
+    for (auto face : mesh.faces()) new_faces[face] = FaceId(face_pool.add());
+    // Null incidences (e.g. the face of a boundary halfedge) stay null.
+    auto new_halfedge = [&](Halfedge he) {
+        return Halfedge(*this, he.null() ? HalfedgeId() : new_halfedges[he]);
+    };
+    auto new_face = [&](Face face) {
+        return Face(*this, face.null() ? FaceId() : new_faces[face]);
+    };
+
+    // Copy the incidences.
     for (auto v : mesh.vertices()) {
-        vertex_indices[v] = vertex_index;
-        new_vertices[vertex_index] = add_vertex();
-        vertex_index += 1;
-    }
-    
-    // To add faces, go through each face in the added mesh,
-    // and iterate over its vertices. Look up the raw index in the vertex attachment
-    // to get a Vertex reference for the corresponding new vertex. A list of these
-    // new vertices is formed to create a new face.
-    auto face_vertices = std::vector<Vertex>();
+        auto new_vertex = Vertex(*this, new_vertices[v]);
+        new_vertex.set_halfedge(new_halfedge(v.halfedge()));
+        vertex_on_boundary[new_vertex] = mesh.vertex_on_boundary[v];
+    }
+    for (auto he : mesh.halfedges()) {
+        auto new_he = new_halfedge(he);
+        new_he.set_next(new_halfedge(he.next()));
+        new_he.set_twin(new_halfedge(he.twin()));
+        new_he.set_vertex(Vertex(*this, new_vertices[he.vertex()]));
+        new_he.set_face(new_face(he.face()));
+        new_he.set_edge(Edge(*this, new_edges[he.edge()]));
+        halfedge_map.insert(new_vertices[he.vertex()].index(), new_vertices[he.tip()].index(), new_he.index());
+    }
+    for (auto edge : mesh.edges()) {
+        auto new_edge = Edge(*this, new_edges[edge]);
+        new_edge.set_halfedge_a(new_halfedge(edge.a()));
+        new_edge.set_halfedge_b(new_halfedge(edge.b()));
+    }
     for (auto face : mesh.faces()) {
-        auto start = face.halfedge();
-        auto he = start;
-        do {
-            face_vertices.push_back(new_vertices[vertex_indices[he.vertex()]]);
-        } while ((he = he.next()) != start);
-        add_face(face_vertices);
-        face_vertices.clear();
-    }
-    
-    // lock();
+        new_face(face).set_halfedge(new_halfedge(face.halfedge()));
+    }
+
+    // The topology of the union is the disjoint union of the topologies.
+    for (auto start : mesh.m_boundary_loops) {
+        m_boundary_loops.push_back(new_halfedge(start));
+    }
+    m_num_interior_vertices += mesh.m_num_interior_vertices;
+    m_num_interior_edges += mesh.m_num_interior_edges;
 }
 
+/* Remove the connected component containing the given face.
+ * The mesh stays locked, and only the removed component is touched (its boundary loops are removed from the
+ * boundary loop list, and the interior element counts are updated), so the cost is proportional to the size of the component.
+ */
 void SurfaceMesh::remove_connected_component(Face starting_face)
 {
     assert(locked());
+    invalidate_connected_components();
 
-    FaceAttachment<char> visited(*this);
-    for (auto face : faces()) visited[face] = false;
-    VertexAttachment<char> vertex_visited(*this);
-    for (auto v : vertices()) vertex_visited[v] = false;
-
-    auto faces_to_remove = std::vector<Face>();
-    auto vertices_to_remove = std::vector<Vertex>();
+    // Find the faces and vertices of the component with a depth-first search.
+    // The visited sets are kept proportional to the size of the component rather than the mesh.
+    std::unordered_set<ElementIndex> face_visited;
+    std::unordered_set<ElementIndex> vertex_visited;
+    auto faces_to_remove = std::vector<FaceId>();
+    auto vertices_to_remove = std::vector<VertexId>();
 
-    std::function<void(Face)> search = [&](Face face) {
-	visited[face] = true;
-        faces_to_remove.push_back(face);
-        auto start = face.halfedge();
-        auto he = start;
-        do {
+    auto stack = std::vector<Face>{starting_face};
+    face_visited.insert(starting_face.index());
+    while (!stack.empty()) {
+        Face face = stack.back();
+        stack.pop_back();
+        faces_to_remove.push_back(face.id());
+        for (auto he : face.halfedges()) {
             assert(!he.twin().null());
-            if (!vertex_visited[he.vertex()]) {
-                vertex_visited[he.vertex()] = true;
-                vertices_to_remove.push_back(he.vertex());
+            if (vertex_visited.insert(he.vertex().index()).second) {
+                vertices_to_remove.push_back(he.vertex().id());
             }
-            if (!he.twin().face().null() && !visited[he.twin().face()]) {
-                search(he.twin().face());
+            auto neighbour = he.twin().face();
+            if (!neighbour.null() && face_visited.insert(neighbour.index()).second) {
+                stack.push_back(neighbour);
             }
-        } while ((he = he.next()) != start);
-    };
-    search(starting_face);
+        }
+    }
+
+    // Remove the boundary loops of the component (those which start at one of its vertices).
+    m_boundary_loops.erase(std::remove_if(m_boundary_loops.begin(), m_boundary_loops.end(), [&](Halfedge start) {
+        return vertex_visited.count(start.vertex().index()) != 0;
+    }), m_boundary_loops.end());
 
-    unlock();
+    // Collect the halfedges (including the boundary halfedges of the component) and the edges.
+    // Interior edges are seen from both sides, and are taken from their lesser halfedge.
+    auto halfedges_to_remove = std::vector<HalfedgeId>();
+    auto edges_to_remove = std::vector<EdgeId>();
     for (auto face : faces_to_remove) {
-        remove_face(face);
+        for (auto he : Face(*this, face).halfedges()) {
+            auto twin = he.twin();
+            bool boundary = twin.face().null();
+            if (boundary) {
+                halfedges_to_remove.push_back(twin.id());
+            }
+            if (boundary || he.index() < twin.index()) {
+                edges_to_remove.push_back(he.edge().id());
+                if (!boundary) m_num_interior_edges -= 1;
+            }
+            halfedges_to_remove.push_back(he.id());
+        }
     }
     for (auto v : vertices_to_remove) {
-        remove_vertex(v);
+        if (!on_boundary(v)) m_num_interior_vertices -= 1;
+    }
+
+    // Remove the elements. The halfedge map entries are removed first, while the halfedge incidences are still valid.
+    for (auto he : halfedges_to_remove) {
+        bool found = halfedge_map.erase(vertex(he).index(), tip(he).index());
+        assert(found);
+        (void) found;
     }
-    lock();
+    for (auto he : halfedges_to_remove) halfedge_pool.remove(he.index());
+    for (auto edge : edges_to_remove) edge_pool.remove(edge.index());
+    for (auto face : faces_to_remove) face_pool.remove(face.index());
+    for (auto v : vertices_to_remove) vertex_pool.remove(v.index());
 }
 
 
@@ -98,3 +176,355 @@ bool SurfaceMesh::is_quad()
 
 
 
+
+
+/*--------------------------------------------------------------------------------
+    Local Euler operators.
+    These edit the locked mesh in place. Only the elements around the edited edge or face are touched
+    (the cost is proportional to the degrees of the vertices involved), new elements reuse removed slots
+    in the pools, and the halfedge map, edges, boundary flags, boundary loops and interior counts are kept valid.
+--------------------------------------------------------------------------------*/
+
+/* Twin two halfedges, and make them the halfedges of the edge.
+ */
+void SurfaceMesh::set_edge_halfedges(Edge edge, Halfedge a, Halfedge b)
+{
+    a.set_twin(b);
+    b.set_twin(a);
+    a.set_edge(edge);
+    b.set_edge(edge);
+    edge.set_halfedge_a(a);
+    edge.set_halfedge_b(b);
+}
+
+/* Set the halfedge of a vertex after an edit, given any of its outgoing halfedges.
+ * A boundary vertex's halfedge must be the first after the boundary (see lock()).
+ */
+void SurfaceMesh::set_vertex_halfedge(Vertex vertex, Halfedge outgoing)
+{
+    if (vertex_on_boundary[vertex]) {
+        while (!outgoing.face().null()) {
+            outgoing = outgoing.twin().next();
+        }
+        outgoing = outgoing.twin().next();
+    }
+    vertex.set_halfedge(outgoing);
+}
+
+/* The halfedge whose next is the given halfedge.
+ */
+Halfedge SurfaceMesh::previous_halfedge(Halfedge halfedge)
+{
+    for (auto he : halfedge.vertex().incoming_halfedges()) {
+        if (he.next() == halfedge) return he;
+    }
+    assert(0);
+    return Halfedge(*this, InvalidElementIndex);
+}
+
+/* Rotate an interior edge between two triangles to connect the two opposite vertices.
+ * Returns false (and does nothing) if the edge is on the boundary or the opposite vertices are already connected.
+ */
+bool SurfaceMesh::can_flip(Edge edge)
+{
+    assert(locked());
+    auto h = edge.a();
+    auto t = edge.b();
+    if (h.face().null() || t.face().null()) return false;
+    assert(h.next().next().next() == h && t.next().next().next() == t);
+    auto c = h.next().tip();
+    auto d = t.next().tip();
+    return c != d && get_halfedge(c, d).null();
+}
+
+bool SurfaceMesh::flip(Edge edge)
+{
+    if (!can_flip(edge)) return false;
+    invalidate_connected_components();
+    // The triangles (a,b,c) and (b,a,d) become (d,c,a) and (c,d,b).
+    auto h = edge.a();
+    auto h1 = h.next();
+    auto h2 = h1.next();
+    auto t = edge.b();
+    auto t1 = t.next();
+    auto t2 = t1.next();
+    auto a = h.vertex();
+    auto b = t.vertex();
+    auto c = h2.vertex();
+    auto d = t2.vertex();
+    auto f0 = h.face();
+    auto f1 = t.face();
+
+    halfedge_map.erase(a.index(), b.index());
+    halfedge_map.erase(b.index(), a.index());
+    h.set_vertex(d);
+    t.set_vertex(c);
+    h.set_next(h2);
+    h2.set_next(t1);
+    t1.set_next(h);
+    t.set_next(t2);
+    t2.set_next(h1);
+    h1.set_next(t);
+    t1.set_face(f0);
+    h1.set_face(f1);
+    f0.set_halfedge(h);
+    f1.set_halfedge(t);
+    halfedge_map.insert(d.index(), c.index(), h.index());
+    halfedge_map.insert(c.index(), d.index(), t.index());
+
+    set_vertex_halfedge(a, t1);
+    set_vertex_halfedge(b, h1);
+    set_vertex_halfedge(c, h2);
+    set_vertex_halfedge(d, t2);
+    return true;
+}
+
+/* Split an edge at a new vertex. Each triangle on the edge is split in two, by an edge from the new vertex to its opposite vertex.
+ * Returns the new vertex.
+ */
+Vertex SurfaceMesh::split(Edge edge)
+{
+    assert(locked());
+    invalidate_connected_components();
+    auto h = edge.a();
+    auto t = edge.b();
+    auto a = h.vertex();
+    auto b = t.vertex();
+    auto f0 = h.face();
+    auto f1 = t.face();
+    auto h_next = h.next();
+    auto t_next = t.next();
+    bool interior = !f0.null() && !f1.null();
+
+    // h (a->b) becomes a->m, and t (b->a) becomes b->m. The new halfedges m->b and m->a complete the two edges.
+    auto m = Vertex(*this, vertex_pool.add());
+    vertex_on_boundary[m] = !interior;
+    auto g = Halfedge(*this, halfedge_pool.add());
+    auto s = Halfedge(*this, halfedge_pool.add());
+    auto edge2 = Edge(*this, edge_pool.add());
+    set_edge_halfedges(edge, h, s);
+    set_edge_halfedges(edge2, g, t);
+    g.set_vertex(m);
+    s.set_vertex(m);
+    halfedge_map.erase(a.index(), b.index());
+    halfedge_map.erase(b.index(), a.index());
+    halfedge_map.insert(a.index(), m.index(), h.index());
+    halfedge_map.insert(m.index(), a.index(), s.index());
+    halfedge_map.insert(m.index(), b.index(), g.index());
+    halfedge_map.insert(b.index(), m.index(), t.index());
+    if (interior) {
+        m_num_interior_vertices += 1;
+        m_num_interior_edges += 1;
+    }
+
+    // Split the triangle (u,v,w) on the side of the halfedge he (u->m) / next_he (m->v), where rest is the old next of he (v->w),
+    // into (u,m,w) and (m,v,w). A boundary side just gets the new halfedge in its loop.
+    auto split_side = [&](Halfedge he, Halfedge next_he, Halfedge rest) {
+        auto face = he.face();
+        if (face.null()) {
+            he.set_next(next_he);
+            next_he.set_next(rest);
+            next_he.set_face(face);
+            return;
+        }
+        auto rest_next = rest.next();
+        auto w = rest_next.vertex();
+        auto x = Halfedge(*this, halfedge_pool.add()); // m->w
+        auto y = Halfedge(*this, halfedge_pool.add()); // w->m
+        set_edge_halfedges(Edge(*this, edge_pool.add()), x, y);
+        x.set_vertex(m);
+        y.set_vertex(w);
+        halfedge_map.insert(m.index(), w.index(), x.index());
+        halfedge_map.insert(w.index(), m.index(), y.index());
+        m_num_interior_edges += 1;
+
+        he.set_next(x);
+        x.set_next(rest_next);
+        x.set_face(face);
+        face.set_halfedge(he);
+
+        auto new_face = Face(*this, face_pool.add());
+        next_he.set_next(rest);
+        rest.set_next(y);
+        y.set_next(next_he);
+        next_he.set_face(new_face);
+        rest.set_face(new_face);
+        y.set_face(new_face);
+        new_face.set_halfedge(next_he);
+        set_vertex_halfedge(w, y);
+    };
+    split_side(h, g, h_next);
+    split_side(t, s, t_next);
+
+    set_vertex_halfedge(m, g);
+    set_vertex_halfedge(a, h);
+    set_vertex_halfedge(b, t);
+    return m;
+}
+
+/* Split a face at a new vertex, connected to each of the face's vertices. Returns the new vertex.
+ */
+Vertex SurfaceMesh::split(Face face)
+{
+    assert(locked());
+    invalidate_connected_components();
+    auto halfedges = std::vector<Halfedge>();
+    for (auto he : face.halfedges()) halfedges.push_back(he);
+    size_t n = halfedges.size();
+
+    auto m = Vertex(*this, vertex_pool.add());
+    vertex_on_boundary[m] = false;
+    m_num_interior_vertices += 1;
+    m_num_interior_edges += n;
+    // An edge from m to each vertex of the face: outgoing[i] is m->v_i, and incoming[i] is v_i->m.
+    auto outgoing = std::vector<Halfedge>(n);
+    auto incoming = std::vector<Halfedge>(n);
+    for (size_t i = 0; i < n; i++) {
+        auto v = halfedges[i].vertex();
+        outgoing[i] = Halfedge(*this, halfedge_pool.add());
+        incoming[i] = Halfedge(*this, halfedge_pool.add());
+        set_edge_halfedges(Edge(*this, edge_pool.add()), outgoing[i], incoming[i]);
+        outgoing[i].set_vertex(m);
+        incoming[i].set_vertex(v);
+        halfedge_map.insert(m.index(), v.index(), outgoing[i].index());
+        halfedge_map.insert(v.index(), m.index(), incoming[i].index());
+    }
+    // Triangle i is (v_i, v_{i+1}, m). The first reuses the face.
+    for (size_t i = 0; i < n; i++) {
+        auto triangle = i == 0 ? face : Face(*this, face_pool.add());
+        auto he = halfedges[i];
+        auto in = incoming[(i + 1) % n];
+        auto out = outgoing[i];
+        he.set_next(in);
+        in.set_next(out);
+        out.set_next(he);
+        he.set_face(triangle);
+        in.set_face(triangle);
+        out.set_face(triangle);
+        triangle.set_halfedge(he);
+    }
+    m.set_halfedge(outgoing[0]);
+    for (size_t i = 0; i < n; i++) {
+        set_vertex_halfedge(halfedges[i].vertex(), halfedges[i]);
+    }
+    return m;
+}
+
+/* Test whether collapsing the halfedge keeps the mesh manifold.
+ * The link condition: the only vertices adjacent to both ends are the opposite vertices of the triangles on the edge,
+ * and the edge between those opposite vertices (if there is one) isn't on triangles with both ends. The second part rejects
+ * collapsing a tetrahedron, which is the only closed component with fewer than 5 vertices, into two faces on three vertices.
+ * Also, an interior edge can't join two boundary vertices, and a triangle can't be removed if its other two edges are on the boundary.
+ */
+bool SurfaceMesh::can_collapse(Halfedge halfedge)
+{
+    assert(locked());
+    auto h = halfedge;
+    auto t = h.twin();
+    auto a = h.vertex();
+    auto b = t.vertex();
+    auto c = h.face().null() ? Vertex(*this, InvalidElementIndex) : h.next().tip();
+    auto d = t.face().null() ? Vertex(*this, InvalidElementIndex) : t.next().tip();
+    for (auto he : {h, t}) {
+        if (he.face().null()) continue;
+        assert(he.next().next().next() == he);
+        if (he.next().twin().face().null() && he.next().next().twin().face().null()) return false;
+    }
+    if (c == d) return false;
+    if (a.on_boundary() && b.on_boundary() && !h.face().null() && !t.face().null()) return false;
+    for (auto u : a.one_ring()) {
+        if (u == b || u == c || u == d) continue;
+        if (!get_halfedge(u, b).null()) return false;
+    }
+    if (!c.null() && !d.null()) {
+        auto cd = get_halfedge(c, d);
+        if (!cd.null()) {
+            auto x = cd.face().null() ? Vertex(*this, InvalidElementIndex) : cd.next().tip();
+            auto y = cd.twin().face().null() ? Vertex(*this, InvalidElementIndex) : cd.twin().next().tip();
+            if ((x == a && y == b) || (x == b && y == a)) return false;
+        }
+    }
+    return true;
+}
+
+/* Collapse a halfedge, merging its vertex into its tip. The triangles on the edge are removed,
+ * and the other two edges of each are merged. Returns false (and does nothing) if the collapse fails can_collapse().
+ */
+bool SurfaceMesh::collapse(Halfedge halfedge)
+{
+    if (!can_collapse(halfedge)) return false;
+    invalidate_connected_components();
+    auto h = halfedge;
+    auto t = h.twin();
+    auto a = h.vertex();
+    auto b = t.vertex();
+    auto removed_edges = std::vector<Edge>{h.edge()};
+    auto removed_halfedges = std::vector<Halfedge>{h, t};
+    bool a_on_boundary = a.on_boundary();
+    bool b_on_boundary = b.on_boundary();
+
+    // The interior counts of the affected vertices and edges are subtracted before the edit, and added back after.
+    auto interior = [](Halfedge he) { return !he.face().null() && !he.twin().face().null(); };
+    m_num_interior_vertices -= (a_on_boundary ? 0 : 1) + (b_on_boundary ? 0 : 1);
+    m_num_interior_edges -= interior(h) ? 1 : 0;
+    // Some outgoing halfedge of b which remains.
+    auto b_outgoing = h.face().null() ? h.next() : h.next().next().twin();
+
+    // Remove the halfedge map entries of a's halfedges. The entries of the halfedges around b are re-added after the edit.
+    auto a_outgoing = std::vector<Halfedge>();
+    for (auto he : a.outgoing_halfedges()) {
+        a_outgoing.push_back(he);
+        halfedge_map.erase(a.index(), he.tip().index());
+        halfedge_map.erase(he.tip().index(), a.index());
+    }
+
+    // On each side, the triangle (u,v,w) of he (u->v) is removed along with its halfedges v->w and w->u, and the edges
+    // of these are merged (the edge of w->v is kept). A boundary halfedge is removed from its boundary loop.
+    auto kept = std::vector<Halfedge>(); // The w->v halfedge of each removed triangle.
+    Halfedge previous[2] = {
+        h.face().null() ? previous_halfedge(h) : Halfedge(*this, InvalidElementIndex),
+        t.face().null() ? previous_halfedge(t) : Halfedge(*this, InvalidElementIndex)
+    };
+    for (int side = 0; side < 2; side++) {
+        auto he = side == 0 ? h : t;
+        if (he.face().null()) {
+            previous[side].set_next(he.next());
+            for (auto &start : m_boundary_loops) {
+                if (start == he) start = he.next();
+            }
+            continue;
+        }
+        auto he1 = he.next();
+        auto he2 = he1.next();
+        m_num_interior_edges -= (interior(he1) ? 1 : 0) + (interior(he2) ? 1 : 0);
+        halfedge_map.erase(he1.vertex().index(), he1.tip().index());
+        halfedge_map.erase(he2.vertex().index(), he2.tip().index());
+        removed_edges.push_back(he2.edge());
+        removed_halfedges.push_back(he1);
+        removed_halfedges.push_back(he2);
+        face_pool.remove(he.face().index());
+        set_edge_halfedges(he1.edge(), he1.twin(), he2.twin());
+        kept.push_back(he1.twin());
+    }
+
+    // Move a's remaining halfedges to b, and remove the elements.
+    for (auto he : a_outgoing) {
+        he.set_vertex(b);
+    }
+    for (auto he : removed_halfedges) halfedge_pool.remove(he.index());
+    for (auto e : removed_edges) edge_pool.remove(e.index());
+    vertex_pool.remove(a.index());
+
+    vertex_on_boundary[b] = a_on_boundary || b_on_boundary;
+    m_num_interior_vertices += vertex_on_boundary[b] ? 0 : 1;
+    set_vertex_halfedge(b, b_outgoing);
+    for (auto he : kept) {
+        m_num_interior_edges += interior(he) ? 1 : 0;
+        set_vertex_halfedge(he.vertex(), he);
+    }
+    for (auto he : b.outgoing_halfedges()) {
+        halfedge_map.insert(b.index(), he.tip().index(), he.index());
+        halfedge_map.insert(he.tip().index(), b.index(), he.twin().index());
+    }
+    return true;
+}
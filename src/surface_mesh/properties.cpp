@@ -0,0 +1,91 @@
+#include "mesh_processing/mesh_processing.h"
+
+
+/*--------------------------------------------------------------------------------
+    Named attachments.
+--------------------------------------------------------------------------------*/
+const char *element_type_name(ElementType element_type)
+{
+    switch (element_type) {
+    case ElementType::Vertex: return "vertex";
+    case ElementType::Halfedge: return "halfedge";
+    case ElementType::Edge: return "edge";
+    case ElementType::Face: return "face";
+    }
+    return "";
+}
+
+
+ElementPool &SurfaceMesh::pool(ElementType element_type)
+{
+    switch (element_type) {
+    case ElementType::Vertex: return vertex_pool;
+    case ElementType::Halfedge: return halfedge_pool;
+    case ElementType::Edge: return edge_pool;
+    case ElementType::Face: return face_pool;
+    }
+    assert(0);
+    return vertex_pool;
+}
+
+
+SurfaceMesh::Property *SurfaceMesh::find_property(ElementType element_type, const std::string &name)
+{
+    return const_cast<Property *>(const_cast<const SurfaceMesh *>(this)->find_property(element_type, name));
+}
+const SurfaceMesh::Property *SurfaceMesh::find_property(ElementType element_type, const std::string &name) const
+{
+    // There are only ever a few properties, so they are searched linearly.
+    for (auto &property : m_properties) {
+        if (property.info.element_type == element_type && property.info.name == name) return &property;
+    }
+    return nullptr;
+}
+
+
+ElementAttachmentBase &SurfaceMesh::insert_property(Property &&property)
+{
+    if (has_property(property.info.element_type, property.info.name)) {
+        std::cerr << "SurfaceMesh error: There is already a " << element_type_name(property.info.element_type)
+                  << " property named \"" << property.info.name << "\".\n";
+        exit(EXIT_FAILURE);
+    }
+    m_properties.push_back(std::move(property));
+    return *m_properties.back().attachment;
+}
+
+
+bool SurfaceMesh::has_property(ElementType element_type, const std::string &name) const
+{
+    return find_property(element_type, name) != nullptr;
+}
+
+
+bool SurfaceMesh::remove_property(ElementType element_type, const std::string &name)
+{
+    Property *property = find_property(element_type, name);
+    if (property == nullptr) return false;
+    // Erasing destroys the attachment, which detaches it from its pool.
+    m_properties.erase(m_properties.begin() + (property - m_properties.data()));
+    return true;
+}
+
+
+std::vector<PropertyInfo> SurfaceMesh::properties() const
+{
+    std::vector<PropertyInfo> infos;
+    for (auto &property : m_properties) {
+        infos.push_back(property.info);
+    }
+    return infos;
+}
+
+
+RawAttachmentView SurfaceMesh::raw_property(ElementType element_type, const std::string &name)
+{
+    Property *property = find_property(element_type, name);
+    if (property == nullptr) return {nullptr, 0, 0, 0, true, nullptr};
+    auto &pool = *property->pool;
+    auto &attachment = *property->attachment;
+    return {attachment.raw_data, attachment.type_size, pool.end_index(), pool.num_elements(), pool.dense(), &pool};
+}
@@ -26,6 +26,7 @@ Face SurfaceMesh::add_face(Vertex *vertices, int num_vertices)
     #define MAX_NUM_VERTICES 20 // Set a maximum number of vertices so dynamic memory doesn't need to be used.
     assert(!locked());
     assert(num_vertices <= MAX_NUM_VERTICES);
+    invalidate_connected_components();
 
     // Create a loop of halfedges around this face, and set up the vertex and halfedge incidence information.
     Halfedge halfedges[MAX_NUM_VERTICES];
@@ -39,7 +40,7 @@ Face SurfaceMesh::add_face(Vertex *vertices, int num_vertices)
         auto he = Halfedge(*this, halfedge_pool.add());
         halfedges[i] = he;
         // Add this to the halfedge_map, which is used to quickly find halfedges between two vertices.
-        halfedge_map[std::pair<ElementIndex,ElementIndex>(u.index(), v.index())] = he.index();
+        halfedge_map.insert(u.index(), v.index(), he.index());
 
         // Update halfedge twin references.
         auto twin_he = get_halfedge(v, u);
@@ -69,6 +70,117 @@ Face SurfaceMesh::add_face(Vertex *vertices, int num_vertices)
 }
 
 
+/*--------------------------------------------------------------------------------
+    Bulk raw editing.
+--------------------------------------------------------------------------------*/
+void SurfaceMesh::reserve(size_t num_vertices, size_t num_halfedges, size_t num_faces)
+{
+    vertex_pool.reserve(num_vertices);
+    halfedge_pool.reserve(num_halfedges);
+    edge_pool.reserve(num_halfedges / 2);
+    face_pool.reserve(num_faces);
+    halfedge_map.reserve(num_halfedges);
+}
+
+ElementIndex SurfaceMesh::add_vertices(size_t num_vertices)
+{
+    assert(!locked());
+    ElementIndex first_vertex = vertex_pool.add_n(num_vertices);
+    for (ElementIndex i = first_vertex; i < first_vertex + num_vertices; i++) {
+        vertex_incidence_data[Vertex(*this, i)].halfedge_index = InvalidElementIndex;
+    }
+    return first_vertex;
+}
+
+namespace {
+// Offsets of each face's vertex indices in the vertex_indices array.
+struct UniformFaceOffsets {
+    size_t face_size;
+    inline size_t operator()(size_t face_index) const { return face_index * face_size; }
+};
+struct PolygonFaceOffsets {
+    const ElementIndex *face_offsets;
+    inline size_t operator()(size_t face_index) const { return face_offsets[face_index]; }
+};
+} // namespace
+
+ElementIndex SurfaceMesh::add_faces(const ElementIndex *vertex_indices, size_t num_faces, size_t face_size)
+{
+    return add_faces_bulk(vertex_indices, num_faces, UniformFaceOffsets{face_size});
+}
+
+ElementIndex SurfaceMesh::add_faces(const ElementIndex *vertex_indices, const ElementIndex *face_offsets, size_t num_faces)
+{
+    return add_faces_bulk(vertex_indices, num_faces, PolygonFaceOffsets{face_offsets});
+}
+
+template <typename FaceOffsets>
+ElementIndex SurfaceMesh::add_faces_bulk(const ElementIndex *vertex_indices, size_t num_faces, FaceOffsets face_offset)
+{
+    Trace::Scope trace("SurfaceMesh::add_faces");
+    assert(!locked());
+    invalidate_connected_components();
+    // Halfedges are created in the same order as add_face() would, so face i's halfedge loop starts
+    // at the halfedge corresponding to its first entry in vertex_indices.
+    size_t base_offset = face_offset(0);
+    size_t num_new_halfedges = face_offset(num_faces) - base_offset;
+    ElementIndex first_face = face_pool.add_n(num_faces);
+    ElementIndex first_halfedge = halfedge_pool.add_n(num_new_halfedges);
+    ElementIndex end_halfedge = first_halfedge + num_new_halfedges;
+
+    // Create the halfedge loops and set up the vertex, next, and face incidence information.
+    // Faces are independent, so this is done in parallel.
+    Parallel::for_range(0, num_faces, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            size_t offset = face_offset(i);
+            size_t n = face_offset(i+1) - offset;
+            assert(n >= 3);
+            auto face = Face(*this, first_face + i);
+            ElementIndex loop_start = first_halfedge + (offset - base_offset);
+            for (size_t k = 0; k < n; k++) {
+                auto he = Halfedge(*this, loop_start + k);
+                he.set_vertex(Vertex(*this, vertex_indices[offset + k]));
+                he.set_next(Halfedge(*this, loop_start + (k+1)%n));
+                he.set_face(face);
+                he.set_twin(Halfedge(*this, InvalidElementIndex));
+            }
+            face.set_halfedge(Halfedge(*this, loop_start));
+        }
+    });
+
+    // Add the new halfedges to the halfedge_map.
+    halfedge_map.reserve(halfedge_map.size() + num_new_halfedges);
+    for (size_t i = 0; i < num_faces; i++) {
+        size_t offset = face_offset(i);
+        size_t n = face_offset(i+1) - offset;
+        ElementIndex loop_start = first_halfedge + (offset - base_offset);
+        for (size_t k = 0; k < n; k++) {
+            size_t previous_size = halfedge_map.size();
+            halfedge_map.insert(vertex_indices[offset + k], vertex_indices[offset + (k+1)%n], loop_start + k);
+            // Check that there was not already a halfedge u->v.
+            assert(halfedge_map.size() == previous_size + 1);
+            (void) previous_size;
+        }
+    }
+
+    // Match twins by looking up the reversed vertex pair. The halfedge_map is only read here, so this is done in parallel.
+    // A new halfedge's twin may be a halfedge that was already in the mesh. That halfedge has no twin yet
+    // (otherwise there would be a duplicate halfedge), and only this halfedge can be its twin, so there are no write conflicts.
+    Parallel::for_range(first_halfedge, end_halfedge, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            auto he = Halfedge(*this, i);
+            auto twin_he = get_halfedge(he.tip(), he.vertex());
+            if (twin_he.null()) continue;
+            he.set_twin(twin_he);
+            if (twin_he.index() < first_halfedge || twin_he.index() >= end_halfedge) {
+                twin_he.set_twin(he);
+            }
+        }
+    });
+    return first_face;
+}
+
+
 bool SurfaceMesh::remove_vertex(Vertex vertex)
 {
     assert(!locked());
@@ -81,6 +193,7 @@ bool SurfaceMesh::remove_vertex(Vertex vertex)
 bool SurfaceMesh::remove_face(Face face)
 {
     assert(!locked());
+    invalidate_connected_components();
     
     // Remove this face's halfedges.
     auto start = face.halfedge();
@@ -95,11 +208,10 @@ bool SurfaceMesh::remove_face(Face face)
         // IMPORTANT: Remove the halfedge from the vertex_indices->halfedge map.
         // Usually, the halfedge tip can be retrieved by he.next().vertex(). However, while deleting this loop of halfedges,
         // there is a special when removing the last halfedge, as its next() is now invalid.
-        auto vertex_indices = next == start ? std::pair<ElementIndex, ElementIndex>(he.vertex().index(), start_vertex.index())
-                                            : std::pair<ElementIndex, ElementIndex>(he.vertex().index(), he.next().vertex().index());
-        auto found = halfedge_map.find(vertex_indices);
-        assert(found != halfedge_map.end());
-        halfedge_map.erase(found);
+        auto tip_index = next == start ? start_vertex.index() : he.next().vertex().index();
+        bool found = halfedge_map.erase(he.vertex().index(), tip_index);
+        assert(found);
+        (void) found;
         // Remove the halfedge.
         halfedge_pool.remove(he.index());
 
@@ -123,10 +235,6 @@ Edge SurfaceMesh::vertices_to_edge(Vertex u, Vertex v)
 //--------------------------------------------------------------------------------
 Halfedge SurfaceMesh::get_halfedge(Vertex u, Vertex v)
 {
-    auto found = halfedge_map.find(std::pair<ElementIndex, ElementIndex>(u.index(), v.index()));
-    if (found == halfedge_map.end()) {
-        return Halfedge(*this, InvalidElementIndex);
-    }
-    return Halfedge(*this, found->second);
+    return Halfedge(*this, halfedge_map.find(u.index(), v.index()));
 }
 
@@ -0,0 +1,116 @@
+#include "mesh_processing/mesh_processing.h"
+#include <atomic>
+
+
+/*--------------------------------------------------------------------------------
+    ChunkedArray
+--------------------------------------------------------------------------------*/
+size_t ChunkedArray::update(const uint8_t *data, size_t _entry_size, size_t _num_entries, const ChunkedArray *previous)
+{
+    // Chunks can only be shared with an array of the same entry size.
+    if (previous != nullptr && previous->entry_size != _entry_size) previous = nullptr;
+    entry_size = _entry_size;
+    num_entries = _num_entries;
+    size_t chunk_bytes = entry_size * chunk_entries;
+    size_t total_bytes = entry_size * num_entries;
+    size_t num_chunks = (num_entries + chunk_entries - 1) / chunk_entries;
+    chunks.resize(num_chunks);
+
+    size_t bytes_copied = 0;
+    for (size_t i = 0; i < num_chunks; i++) {
+        const uint8_t *chunk_data = data + i * chunk_bytes;
+        size_t bytes = std::min(chunk_bytes, total_bytes - i * chunk_bytes);
+        if (previous != nullptr && i < previous->chunks.size()) {
+            const Chunk &previous_chunk = previous->chunks[i];
+            if (previous_chunk->size() == bytes && memcmp(previous_chunk->data(), chunk_data, bytes) == 0) {
+                chunks[i] = previous_chunk;
+                continue;
+            }
+        }
+        chunks[i] = std::make_shared<const std::vector<uint8_t>>(chunk_data, chunk_data + bytes);
+        bytes_copied += bytes;
+    }
+    return bytes_copied;
+}
+
+
+/*--------------------------------------------------------------------------------
+    MeshVersions
+--------------------------------------------------------------------------------*/
+MeshVersions::MeshVersions(SurfaceMesh &_mesh) :
+    mesh{_mesh}
+{}
+
+std::shared_ptr<const MeshSnapshot> MeshVersions::snapshot() const
+{
+    return std::atomic_load(&m_snapshot);
+}
+
+size_t MeshVersions::update(ChunkedArray &array, const ElementAttachmentBase &attachment, const ElementPool &pool,
+                            const ChunkedArray *previous)
+{
+    // Entries past the end index are never active, so aren't included.
+    return array.update(attachment.raw_data, attachment.type_size, pool.end_index(), previous);
+}
+
+size_t MeshVersions::publish()
+{
+    // Only the writer thread calls publish(), so the previous snapshot doesn't change while this runs.
+    auto previous_snapshot = std::atomic_load(&m_snapshot);
+    const MeshSnapshot *previous = previous_snapshot.get();
+    auto snapshot = std::make_shared<MeshSnapshot>();
+    size_t bytes_copied = 0;
+
+    const ElementPool *pools[MeshSnapshot::NumPools] = {&mesh.vertex_pool, &mesh.halfedge_pool, &mesh.edge_pool, &mesh.face_pool};
+    for (int i = 0; i < MeshSnapshot::NumPools; i++) {
+        auto &pool = snapshot->pools[i];
+        pool.end_index = pools[i]->end_index();
+        pool.num_elements = pools[i]->num_elements();
+        size_t num_words = (size_t(pool.end_index) + 63) / 64;
+        bytes_copied += pool.active_words.update(reinterpret_cast<const uint8_t *>(pools[i]->m_active_words.data()),
+                                                 sizeof(uint64_t), num_words,
+                                                 previous == nullptr ? nullptr : &previous->pools[i].active_words);
+    }
+    bytes_copied += update(snapshot->vertex_incidence, mesh.vertex_incidence_data, mesh.vertex_pool,
+                           previous == nullptr ? nullptr : &previous->vertex_incidence);
+    bytes_copied += update(snapshot->edge_incidence, mesh.edge_incidence_data, mesh.edge_pool,
+                           previous == nullptr ? nullptr : &previous->edge_incidence);
+    bytes_copied += update(snapshot->face_incidence, mesh.face_incidence_data, mesh.face_pool,
+                           previous == nullptr ? nullptr : &previous->face_incidence);
+    bytes_copied += update(snapshot->vertex_on_boundary, mesh.vertex_on_boundary, mesh.vertex_pool,
+                           previous == nullptr ? nullptr : &previous->vertex_on_boundary);
+
+    // The halfedge incidences are stored in one attachment or several, depending on the layout.
+    const ElementAttachmentBase *relation_attachments[MeshSnapshot::NumHalfedgeFields];
+    size_t relation_offsets[MeshSnapshot::NumHalfedgeFields];
+    mesh.halfedge_incidence_data.relation_storage(relation_attachments, relation_offsets);
+    std::vector<const ElementAttachmentBase *> halfedge_attachments;
+    for (int i = 0; i < MeshSnapshot::NumHalfedgeFields; i++) {
+        auto found = std::find(halfedge_attachments.begin(), halfedge_attachments.end(), relation_attachments[i]);
+        snapshot->halfedge_fields[i] = {size_t(found - halfedge_attachments.begin()), relation_offsets[i]};
+        if (found == halfedge_attachments.end()) halfedge_attachments.push_back(relation_attachments[i]);
+    }
+    snapshot->halfedge_incidence.resize(halfedge_attachments.size());
+    for (size_t i = 0; i < halfedge_attachments.size(); i++) {
+        bytes_copied += update(snapshot->halfedge_incidence[i], *halfedge_attachments[i], mesh.halfedge_pool,
+                               previous == nullptr ? nullptr : &previous->halfedge_incidence[i]);
+    }
+
+    snapshot->attachments.resize(tracked.size());
+    for (size_t i = 0; i < tracked.size(); i++) {
+        bool tracked_before = previous != nullptr && i < previous->attachments.size();
+        bytes_copied += update(snapshot->attachments[i], *tracked[i].attachment, *tracked[i].pool,
+                               tracked_before ? &previous->attachments[i] : nullptr);
+    }
+
+    snapshot->m_version = previous == nullptr ? 0 : previous->m_version + 1;
+    snapshot->m_locked = mesh.locked();
+    snapshot->m_num_interior_vertices = mesh.locked() ? mesh.m_num_interior_vertices : 0;
+    snapshot->m_num_interior_edges = mesh.locked() ? mesh.m_num_interior_edges : 0;
+    for (auto start : mesh.m_boundary_loops) {
+        snapshot->m_boundary_loops.push_back(start.id());
+    }
+
+    std::atomic_store(&m_snapshot, std::shared_ptr<const MeshSnapshot>(snapshot));
+    return bytes_copied;
+}
@@ -0,0 +1,259 @@
+#include "mesh_processing/mesh_processing.h"
+
+
+bool SurfaceMesh::dense() const
+{
+    return vertex_pool.dense() && halfedge_pool.dense() && edge_pool.dense() && face_pool.dense();
+}
+
+
+SurfaceMesh::ElementIndexMaps SurfaceMesh::garbage_collect(bool shrink_to_fit)
+{
+    Trace::Scope trace("SurfaceMesh::garbage_collect");
+    // Compact each pool. This moves the data of every attachment (including the incidence data) with its elements,
+    // but the incidence data still holds old indices.
+    ElementIndexMaps maps;
+    maps.vertices = vertex_pool.compact(shrink_to_fit);
+    maps.halfedges = halfedge_pool.compact(shrink_to_fit);
+    maps.edges = edge_pool.compact(shrink_to_fit);
+    maps.faces = face_pool.compact(shrink_to_fit);
+    remap_incidence(maps);
+    return maps;
+}
+
+
+SurfaceMesh::ElementIndexMaps SurfaceMesh::reorder(const std::vector<ElementIndex> &vertex_order)
+{
+    Trace::Scope trace("SurfaceMesh::reorder");
+    assert(vertex_order.size() == num_vertices());
+    ElementIndexMaps new_to_old;
+    new_to_old.vertices = vertex_order;
+    auto vertex_old_to_new = std::vector<ElementIndex>(vertex_pool.end_index(), InvalidElementIndex);
+    for (size_t i = 0; i < vertex_order.size(); i++) {
+        vertex_old_to_new[vertex_order[i]] = i;
+    }
+
+    // Sort the faces by their least new vertex index, breaking ties by the old face index.
+    auto face_keys = std::vector<uint64_t>(num_faces());
+    {
+        auto face_indices = std::vector<ElementIndex>();
+        face_indices.reserve(num_faces());
+        for (auto face_index = face_pool.begin(); face_index != face_pool.end(); ++face_index) {
+            face_indices.push_back(*face_index);
+        }
+        Parallel::for_range(0, face_indices.size(), [&](size_t begin, size_t end) {
+            for (size_t i = begin; i < end; i++) {
+                ElementIndex least_vertex = InvalidElementIndex;
+                for (auto v : Face(*this, face_indices[i]).vertices()) {
+                    least_vertex = std::min(least_vertex, vertex_old_to_new[v.index()]);
+                }
+                face_keys[i] = (uint64_t(least_vertex) << 32) | face_indices[i];
+            }
+        });
+    }
+    std::sort(face_keys.begin(), face_keys.end());
+    new_to_old.faces.resize(face_keys.size());
+    for (size_t i = 0; i < face_keys.size(); i++) {
+        new_to_old.faces[i] = ElementIndex(face_keys[i] & 0xFFFFFFFF);
+    }
+
+    // Group the halfedges by face, then by boundary loop.
+    new_to_old.halfedges.reserve(num_halfedges());
+    for (ElementIndex face_index : new_to_old.faces) {
+        for (auto he : Face(*this, face_index).halfedges()) {
+            new_to_old.halfedges.push_back(he.index());
+        }
+    }
+    if (locked()) {
+        for (auto start : m_boundary_loops) {
+            for (auto he : start.loop()) {
+                new_to_old.halfedges.push_back(he.index());
+            }
+        }
+    }
+    assert(new_to_old.halfedges.size() == num_halfedges());
+
+    // Edges follow the order of their first halfedge.
+    if (locked()) {
+        new_to_old.edges.reserve(edge_pool.num_elements());
+        auto edge_added = std::vector<char>(edge_pool.end_index(), false);
+        for (ElementIndex halfedge_index : new_to_old.halfedges) {
+            ElementIndex edge_index = Halfedge(*this, halfedge_index).edge().index();
+            if (!edge_added[edge_index]) {
+                edge_added[edge_index] = true;
+                new_to_old.edges.push_back(edge_index);
+            }
+        }
+    }
+    return permute(new_to_old);
+}
+
+
+SurfaceMesh::ElementIndexMaps SurfaceMesh::permute(const ElementIndexMaps &new_to_old)
+{
+    // Invert the new-to-old lists.
+    auto invert = [](const std::vector<ElementIndex> &order, size_t old_size) {
+        auto map = std::vector<ElementIndex>(old_size, InvalidElementIndex);
+        for (size_t i = 0; i < order.size(); i++) {
+            map[order[i]] = i;
+        }
+        return map;
+    };
+    ElementIndexMaps maps;
+    maps.vertices = invert(new_to_old.vertices, vertex_pool.end_index());
+    maps.halfedges = invert(new_to_old.halfedges, halfedge_pool.end_index());
+    maps.edges = invert(new_to_old.edges, edge_pool.end_index());
+    maps.faces = invert(new_to_old.faces, face_pool.end_index());
+
+    vertex_pool.permute(new_to_old.vertices, vertex_pool.capacity());
+    halfedge_pool.permute(new_to_old.halfedges, halfedge_pool.capacity());
+    edge_pool.permute(new_to_old.edges, edge_pool.capacity());
+    face_pool.permute(new_to_old.faces, face_pool.capacity());
+    remap_incidence(maps);
+    return maps;
+}
+
+
+void SurfaceMesh::remap_incidence(const ElementIndexMaps &maps)
+{
+    // Null (InvalidElementIndex) references stay null.
+    auto remap = [](const std::vector<ElementIndex> &map, ElementIndex index) {
+        return index == InvalidElementIndex ? InvalidElementIndex : map[index];
+    };
+    Parallel::for_range(0, vertex_pool.end_index(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            auto &incidence = vertex_incidence_data[Vertex(*this, i)];
+            incidence.halfedge_index = remap(maps.halfedges, incidence.halfedge_index);
+        }
+    });
+    Parallel::for_range(0, face_pool.end_index(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            auto &incidence = face_incidence_data[Face(*this, i)];
+            incidence.halfedge_index = remap(maps.halfedges, incidence.halfedge_index);
+        }
+    });
+    Parallel::for_range(0, edge_pool.end_index(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            auto &incidence = edge_incidence_data[Edge(*this, i)];
+            incidence.halfedge_indices[0] = remap(maps.halfedges, incidence.halfedge_indices[0]);
+            incidence.halfedge_indices[1] = remap(maps.halfedges, incidence.halfedge_indices[1]);
+        }
+    });
+    Parallel::for_range(0, halfedge_pool.end_index(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            auto &incidence = halfedge_incidence_data;
+            incidence.next(i) = remap(maps.halfedges, incidence.next(i));
+            incidence.twin(i) = remap(maps.halfedges, incidence.twin(i));
+            incidence.vertex(i) = remap(maps.vertices, incidence.vertex(i));
+            incidence.face(i) = remap(maps.faces, incidence.face(i));
+            // Halfedge->edge incidences are only valid when the mesh is locked.
+            incidence.edge(i) = locked() ? remap(maps.edges, incidence.edge(i)) : InvalidElementIndex;
+        }
+    });
+
+    // Rebuild the halfedge_map.
+    halfedge_map.clear();
+    halfedge_map.reserve(num_halfedges());
+    for (auto he : halfedges()) {
+        halfedge_map.insert(he.vertex().index(), he.tip().index(), he.index());
+    }
+
+    // Remap the cached topology.
+    for (auto &he : m_boundary_loops) {
+        he = Halfedge(*this, maps.halfedges[he.index()]);
+    }
+    // The components are numbered in order of their least face, so are recomputed.
+    invalidate_connected_components();
+}
+
+
+size_t SurfaceMesh::MemoryUsage::allocated_bytes() const
+{
+    size_t bytes = 0;
+    for (auto items : {&pools, &attachments, &indices}) {
+        for (auto &item : *items) bytes += item.allocated_bytes;
+    }
+    return bytes;
+}
+
+size_t SurfaceMesh::MemoryUsage::used_bytes() const
+{
+    size_t bytes = 0;
+    for (auto items : {&pools, &attachments, &indices}) {
+        for (auto &item : *items) bytes += item.used_bytes;
+    }
+    return bytes;
+}
+
+void SurfaceMesh::MemoryUsage::printout() const
+{
+    printf("%-40s %14s %14s\n", "", "allocated", "used");
+    for (auto items : {&pools, &attachments, &indices}) {
+        for (auto &item : *items) {
+            printf("%-40s %14zu %14zu\n", item.name.c_str(), item.allocated_bytes, item.used_bytes);
+        }
+    }
+    printf("%-40s %14zu %14zu\n", "total", allocated_bytes(), used_bytes());
+}
+
+
+SurfaceMesh::MemoryUsage SurfaceMesh::memory_usage() const
+{
+    // Name the attachments owned by the mesh. Any others on the pools are owned outside of the mesh.
+    std::vector<std::pair<const ElementAttachmentBase *, std::string>> names = {
+        {&vertex_incidence_data, "vertex incidence"},
+        {&vertex_on_boundary, "vertex on_boundary"},
+        {&edge_incidence_data, "edge incidence"},
+        {&face_incidence_data, "face incidence"},
+    };
+    const ElementAttachmentBase *relations[5];
+    size_t offsets[5];
+    halfedge_incidence_data.relation_storage(relations, offsets);
+    const char *relation_names[5] = {"next", "vertex", "face", "twin", "edge"};
+    if (relations[0] == relations[1]) {
+        // The AoS layout stores all relations in one attachment.
+        names.emplace_back(relations[0], "halfedge incidence");
+    } else {
+        for (int i = 0; i < 5; i++) names.emplace_back(relations[i], std::string("halfedge ") + relation_names[i]);
+    }
+    for (auto &property : m_properties) {
+        names.emplace_back(property.attachment.get(),
+                           std::string(element_type_name(property.info.element_type)) + " property \"" + property.info.name + "\"");
+    }
+    if (m_component_labels) names.emplace_back(m_component_labels.get(), "face component labels");
+
+    MemoryUsage usage;
+    const std::pair<const char *, const ElementPool *> pools[4] = {
+        {"vertex", &vertex_pool}, {"halfedge", &halfedge_pool}, {"edge", &edge_pool}, {"face", &face_pool}
+    };
+    for (auto &named_pool : pools) {
+        const ElementPool &pool = *named_pool.second;
+        size_t used_words = (size_t(pool.end_index()) + 63) / 64;
+        usage.pools.push_back({std::string(named_pool.first) + " pool", pool.allocated_bytes(),
+                               used_words * sizeof(uint64_t) + pool.num_free_slots() * sizeof(ElementIndex)});
+        for (auto attachment : pool.attachments) {
+            std::string name = std::string(named_pool.first) + " attachment";
+            for (auto &named : names) {
+                if (named.first == attachment) name = named.second;
+            }
+            usage.attachments.push_back({name, attachment->allocated_bytes(), pool.num_elements() * attachment->type_size});
+        }
+    }
+    usage.indices.push_back({"halfedge_map", halfedge_map.allocated_bytes(), halfedge_map.used_bytes()});
+    usage.indices.push_back({"boundary loops", m_boundary_loops.capacity() * sizeof(Halfedge), m_boundary_loops.size() * sizeof(Halfedge)});
+    usage.indices.push_back({"connected components", m_connected_components.capacity() * sizeof(Face),
+                             m_connected_components.size() * sizeof(Face)});
+    return usage;
+}
+
+
+void SurfaceMesh::shrink_to_fit()
+{
+    vertex_pool.shrink_to_fit();
+    halfedge_pool.shrink_to_fit();
+    edge_pool.shrink_to_fit();
+    face_pool.shrink_to_fit();
+    halfedge_map.shrink_to_fit();
+    m_boundary_loops.shrink_to_fit();
+    m_connected_components.shrink_to_fit();
+}
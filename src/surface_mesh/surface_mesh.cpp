@@ -4,307 +4,376 @@
 
 SurfaceMesh g_dummy_surface_mesh;
 
+namespace {
+// A full pool grows to at least this capacity, so that small pools don't double from 1.
+constexpr size_t min_growth_capacity = 64;
+} // namespace
+
 /*--------------------------------------------------------------------------------
     ElementPool implementations.
 --------------------------------------------------------------------------------*/
 ElementPool::ElementPool(size_t capacity) :
-    active_flags(capacity),
-    least_inactive_index{0},
+    m_active_words((capacity + 63) / 64, 0),
+    m_end{0},
+    m_capacity{capacity},
     m_num_elements{0}
 {
     assert(capacity > 0);
 }
 
-size_t ElementPool::capacity() const
+void ElementPool::printout()
 {
-    return active_flags.size();
+    for (size_t i = 0; i < capacity(); i++) {
+        printf(is_active(i) ? "1" : "0");
+    }
+    printf(" (%zu)\n", capacity());
 }
 
-void ElementPool::printout()
+
+void ElementPool::grow(size_t new_capacity)
 {
-    for (bool val : active_flags) {
-        printf(val ? "1" : "0");
+    assert(new_capacity > m_capacity);
+    m_active_words.resize((new_capacity + 63) / 64, 0);
+    m_capacity = new_capacity;
+    // Use the virtual resize() method to resize the attachments in the same way.
+    // These new attachment entries will be value initialized, which uses the default constructor if available.
+    for (auto attachment : attachments) {
+        attachment->resize(new_capacity);
     }
-    printf(" (%zu)\n", capacity());
 }
 
 
 ElementIndex ElementPool::add()
 {
-    ElementIndex index = least_inactive_index;
-    size_t n = capacity();
-    for (; index < n; index++) {
-        if (!is_active(index)) {
-            break;
-        }
-    }
-    assert(index != n); // note: An invariant maintained by ElementPool is that there is always at least one available entry.
-    if (index == n - 1) {
-        // The pool is full, grow it.
-        size_t new_capacity = 2*n;
-        active_flags.resize(new_capacity, 0);
-        // Use the virtual resize() method to resize the attachments in the same way.
-        // These new attachment entries will be value initialized, which uses the default constructor if available.
-        for (auto attachment : attachments) {
-            attachment->resize(new_capacity);
+    ElementIndex index;
+    if (!m_free_list.empty()) {
+        // Reuse the most recently removed slot.
+        index = m_free_list.back();
+        m_free_list.pop_back();
+    } else {
+        if (m_end == m_capacity) {
+            // The pool is full, grow it. Small pools are grown to a minimum size, rather than doubling from 1.
+            grow(std::max<size_t>(2*m_capacity, min_growth_capacity));
         }
+        index = m_end++;
     }
     for (auto attachment : attachments) {
+        if (attachment->trivial) {
+            // Trivial entries don't need to be constructed. Only a default value is copied in.
+            if (attachment->raw_default_value != nullptr) {
+                memcpy(attachment->raw_data + index * attachment->type_size, attachment->raw_default_value, attachment->type_size);
+            }
+            continue;
+        }
         // Use the virtual create() method to create the default entry.
         attachment->create(index);
     }
-    active_flags[index] = true;
-    least_inactive_index = index+1;
+    m_active_words[index >> 6] |= uint64_t(1) << (index & 63);
 
     m_num_elements += 1; // update the cached element count.
     return index;
 }
 
 
-void ElementPool::remove(ElementIndex element_index)
+ElementIndex ElementPool::add_n(size_t n)
 {
-    assert(is_active(element_index)); // Can only remove elements that are actually there.
-    if (element_index < least_inactive_index) {
-        least_inactive_index = element_index;
+    ElementIndex first_index = m_end;
+    if (n == 0) return first_index;
+    assert(size_t(m_end) + n < size_t(InvalidElementIndex));
+    if (m_end + n > m_capacity) {
+        grow(std::max(2*m_capacity, m_end + n));
     }
-    // Use the virtual destroy() method to tear down the entry.
     for (auto attachment : attachments) {
-        attachment->destroy(element_index);
+        // Use the virtual create_range() method to create the default entries.
+        attachment->create_range(first_index, n);
     }
-    active_flags[element_index] = false;
-    m_num_elements -= 1; // update the cached element count.
+    for (ElementIndex index = first_index; index < first_index + n; index++) {
+        m_active_words[index >> 6] |= uint64_t(1) << (index & 63);
+    }
+    m_end += n;
+    m_num_elements += n; // update the cached element count.
+    return first_index;
 }
 
-ElementPoolIterator ElementPool::begin()
+
+void ElementPool::reserve(size_t capacity)
 {
-    return ElementPoolIterator(this, 0);
+    if (capacity > m_capacity) grow(capacity);
 }
-ElementPoolIterator ElementPool::end()
+
+
+size_t ElementPool::allocated_bytes() const
 {
-    return ElementPoolIterator(this, InvalidElementIndex);
+    return m_active_words.capacity() * sizeof(uint64_t)
+         + m_free_list.capacity() * sizeof(ElementIndex)
+         + attachments.capacity() * sizeof(ElementAttachmentBase *);
 }
 
 
+void ElementPool::shrink_to_fit()
+{
+    // Keep a capacity of at least 1, as the constructor does.
+    size_t new_capacity = std::max<size_t>(m_end, 1);
+    if (new_capacity < m_capacity) {
+        m_active_words.resize((new_capacity + 63) / 64);
+        m_capacity = new_capacity;
+        for (auto attachment : attachments) {
+            attachment->resize(new_capacity);
+        }
+    }
+    m_active_words.shrink_to_fit();
+    m_free_list.shrink_to_fit();
+}
 
 
-
-/*--------------------------------------------------------------------------------
-    ElementPoolIterator
---------------------------------------------------------------------------------*/
-ElementPoolIterator::ElementPoolIterator(ElementPool *_element_pool, ElementIndex _element_index) :
-    element_pool{_element_pool},
-    element_index{_element_index},
-    n{_element_pool->capacity()}
-{
-    // Set up the beginning index (the first active entry in the pool).
-    if (element_index != InvalidElementIndex) {
-        ElementIndex i = element_index;
-        for (; i < n; i++) {
-            if (element_pool->is_active(i)) {
-                element_index = i;
-                break;
+std::vector<std::pair<ElementIndex, size_t>> ElementPool::active_runs() const
+{
+    std::vector<std::pair<ElementIndex, size_t>> runs;
+    if (dense()) {
+        if (m_end > 0) runs.emplace_back(0, m_end);
+        return runs;
+    }
+    // Scan the bitmap a word at a time, so that whole words of active or inactive elements are skipped.
+    ElementIndex run_start = InvalidElementIndex;
+    for (size_t word_index = 0; word_index < (size_t(m_end) + 63) / 64; word_index++) {
+        uint64_t bits = m_active_words[word_index];
+        bool in_run = run_start != InvalidElementIndex;
+        if (bits == (in_run ? ~uint64_t(0) : 0)) continue;
+        for (int bit = 0; bit < 64; bit++) {
+            ElementIndex index = ElementIndex(word_index * 64 + bit);
+            if (index >= m_end) break;
+            bool active = (bits >> bit) & 1;
+            if (active && run_start == InvalidElementIndex) {
+                run_start = index;
+            } else if (!active && run_start != InvalidElementIndex) {
+                runs.emplace_back(run_start, index - run_start);
+                run_start = InvalidElementIndex;
             }
         }
-        if (i == n) element_index = InvalidElementIndex;
     }
+    if (run_start != InvalidElementIndex) runs.emplace_back(run_start, m_end - run_start);
+    return runs;
 }
-ElementIndex ElementPoolIterator::operator*() const
+
+
+void ElementPool::remove(ElementIndex element_index)
 {
-    return element_index;
+    assert(is_active(element_index)); // Can only remove elements that are actually there.
+    // Use the virtual destroy() method to tear down the entry. Trivial entries don't need to be destroyed.
+    for (auto attachment : attachments) {
+        if (!attachment->trivial) attachment->destroy(element_index);
+    }
+    m_active_words[element_index >> 6] &= ~(uint64_t(1) << (element_index & 63));
+    m_free_list.push_back(element_index);
+    m_num_elements -= 1; // update the cached element count.
 }
-ElementPoolIterator &ElementPoolIterator::operator++()
+
+void ElementPool::clear()
 {
-    for (ElementIndex i = element_index+1; i < n; i++) {
-        if (element_pool->is_active(i)) {
-            element_index = i;
-            return *this;
+    for (auto attachment : attachments) {
+        if (attachment->trivial) continue;
+        for (auto index = begin(); index != end(); ++index) {
+            attachment->destroy(*index);
         }
     }
-    element_index = InvalidElementIndex;
-    return *this;
+    std::fill(m_active_words.begin(), m_active_words.end(), 0);
+    m_free_list.clear();
+    m_end = 0;
+    m_num_elements = 0;
 }
 
-// Equality/inequality assumes that the element pools are the same,
-// which is probably reasonable.
-bool ElementPoolIterator::operator==(const ElementPoolIterator &other) const
+void ElementPool::permute(const std::vector<ElementIndex> &new_to_old, size_t new_capacity)
 {
-    return element_index == other.element_index;
+    size_t n = new_to_old.size();
+    assert(n == m_num_elements && new_capacity >= n && new_capacity > 0);
+    for (auto attachment : attachments) {
+        attachment->permute(new_to_old.data(), n, new_capacity);
+    }
+    m_active_words.assign((new_capacity + 63) / 64, 0);
+    for (size_t i = 0; i < n / 64; i++) {
+        m_active_words[i] = ~uint64_t(0);
+    }
+    if (n % 64 != 0) {
+        m_active_words[n / 64] = (uint64_t(1) << (n % 64)) - 1;
+    }
+    m_free_list.clear();
+    m_end = n;
+    m_capacity = new_capacity;
 }
-bool ElementPoolIterator::operator!=(const ElementPoolIterator &other) const
+
+std::vector<ElementIndex> ElementPool::compact(bool shrink_to_fit)
 {
-    return !operator==(other);
+    std::vector<ElementIndex> old_to_new(m_end, InvalidElementIndex);
+    std::vector<ElementIndex> new_to_old;
+    new_to_old.reserve(m_num_elements);
+    for (auto index = begin(); index != end(); ++index) {
+        old_to_new[*index] = new_to_old.size();
+        new_to_old.push_back(*index);
+    }
+    permute(new_to_old, shrink_to_fit ? std::max<size_t>(m_num_elements, 1) : m_capacity);
+    return old_to_new;
 }
 
+void ElementPool::copy(const ElementPool &other)
+{
+    m_active_words = other.m_active_words;
+    m_free_list = other.m_free_list;
+    m_end = other.m_end;
+    m_capacity = other.m_capacity;
+    m_num_elements = other.m_num_elements;
+    for (auto attachment : attachments) {
+        attachment->resize(m_capacity);
+    }
+}
+
+ElementPoolIterator ElementPool::begin() const
+{
+    return ElementPoolIterator(this, 0);
+}
+ElementPoolIterator ElementPool::end() const
+{
+    return ElementPoolIterator(this, InvalidElementIndex);
+}
+
+
 
 
 
 /*--------------------------------------------------------------------------------
-    ElementHandle
+    ElementPoolIterator
 --------------------------------------------------------------------------------*/
+ElementPoolIterator::ElementPoolIterator(const ElementPool *_element_pool, ElementIndex _element_index) :
+    element_pool{_element_pool},
+    element_index{_element_index},
+    end_index{_element_pool == nullptr ? InvalidElementIndex : _element_pool->end_index()},
+    dense{_element_pool == nullptr || _element_pool->dense()}
+{
+    // InvalidElementIndex is used to construct the end iterator.
+    // Otherwise, set up the beginning index (the first active entry in the pool at or after element_index).
+    if (element_index == InvalidElementIndex) {
+        element_index = end_index;
+    } else if (!dense) {
+        element_index = next_active(element_index);
+    } else if (element_index > end_index) {
+        element_index = end_index;
+    }
+}
 
-ElementHandle::ElementHandle(SurfaceMesh &_mesh, ElementIndex _index) :
-    mesh{_mesh}, m_index{_index}
-{}
-
-// Copy assignment.
-ElementHandle &ElementHandle::operator=(const ElementHandle &other) {
-    //----If buggy, check this!
-    // Placement-new is used here so the mesh reference member can be copied.
-    new(this) ElementHandle(other);
-    return *this;
+// Find the first active index at or after from, or end_index if there is none.
+ElementIndex ElementPoolIterator::next_active(ElementIndex from) const
+{
+    if (from >= end_index) return end_index;
+    const uint64_t *words = &element_pool->m_active_words[0];
+    size_t word_index = from >> 6;
+    size_t end_word_index = (size_t(end_index) + 63) >> 6;
+    // Mask out the flags of elements before from.
+    uint64_t bits = words[word_index] & (~uint64_t(0) << (from & 63));
+    while (bits == 0) {
+        // Skip a whole word of inactive elements.
+        if (++word_index == end_word_index) return end_index;
+        bits = words[word_index];
+    }
+    // The least set bit is the next active element.
+    ElementIndex index = ElementIndex((word_index << 6) + __builtin_ctzll(bits));
+    return index < end_index ? index : end_index;
 }
 
 
-ElementAttachmentBase::ElementAttachmentBase(size_t _type_size) :
-    type_size{_type_size}, raw_data{nullptr}
+ElementAttachmentBase::ElementAttachmentBase(size_t _type_size, bool _trivial) :
+    type_size{_type_size}, raw_data{nullptr}, trivial{_trivial}, raw_default_value{nullptr}
 {}
 
 
 
 
+/*--------------------------------------------------------------------------------
+    Element handle incidence setters.
+--------------------------------------------------------------------------------*/
 void Vertex::set_halfedge(Halfedge halfedge)
 {
-    mesh.vertex_incidence_data[*this].halfedge_index = halfedge.index();
+    mesh->vertex_incidence_data[id()].halfedge_index = halfedge.index();
 }
 
 void Halfedge::set_vertex(Vertex vertex)
 {
-    mesh.halfedge_incidence_data[*this].vertex_index = vertex.index();
+    mesh->halfedge_incidence_data.vertex(m_index) = vertex.index();
 }
 void Halfedge::set_face(Face face)
 {
-    mesh.halfedge_incidence_data[*this].face_index = face.index();
+    mesh->halfedge_incidence_data.face(m_index) = face.index();
 }
 void Halfedge::set_next(Halfedge halfedge)
 {
-    mesh.halfedge_incidence_data[*this].next_index = halfedge.index();
+    mesh->halfedge_incidence_data.next(m_index) = halfedge.index();
 }
 void Halfedge::set_twin(Halfedge halfedge)
 {
-    mesh.halfedge_incidence_data[*this].twin_index = halfedge.index();
+    mesh->halfedge_incidence_data.twin(m_index) = halfedge.index();
 }
 void Halfedge::set_edge(Edge edge)
 {
-    mesh.halfedge_incidence_data[*this].edge_index = edge.index();
+    mesh->halfedge_incidence_data.edge(m_index) = edge.index();
 }
 
 void Edge::set_halfedge_a(Halfedge halfedge)
 {
-    mesh.edge_incidence_data[*this].halfedge_indices[0] = halfedge.index();
+    mesh->edge_incidence_data[id()].halfedge_indices[0] = halfedge.index();
 }
 void Edge::set_halfedge_b(Halfedge halfedge)
 {
-    mesh.edge_incidence_data[*this].halfedge_indices[1] = halfedge.index();
+    mesh->edge_incidence_data[id()].halfedge_indices[1] = halfedge.index();
 }
 
-
-
-
-Halfedge Vertex::halfedge() const
-{
-    // Not valid when mesh is unlocked.
-    //   (Unlocked meshes don't have full half-edge data, so vertex->halfedge relations don't give full information for traversal.
-    //    It is simpler to just not expect valid vertex incidences, and set them up only when the mesh is locked.)
-    if (!mesh.locked()) {
-        std::cerr << "mesh traversal error: vertex->halfedge traversal is only valid when the mesh is locked.\n";
-        exit(EXIT_FAILURE);
-    }
-    return Halfedge(mesh, mesh.vertex_incidence_data[*this].halfedge_index);
-}
-size_t Vertex::num_adjacent_vertices() const
+void Face::set_halfedge(Halfedge halfedge)
 {
-    if (!mesh.locked()) {
-        std::cerr << "mesh traversal error: Vertex::num_adjacent_vertices() is only valid when the mesh is locked.\n";
-        exit(EXIT_FAILURE);
-    }
-    auto start = halfedge();
-    auto he = start;
-    int n = 0;
-    do {
-        n++;
-    } while ((he = he.twin().next()) != start);
-    return n;
+    mesh->face_incidence_data[id()].halfedge_index = halfedge.index();
 }
 
-bool Vertex::on_boundary() const
-{
-    if (!mesh.locked()) {
-        std::cerr << "mesh traversal error: Vertex::on_boundary() is only valid when the mesh is locked.\n";
-        exit(EXIT_FAILURE);
-    }
-    return mesh.vertex_on_boundary[*this] != 0;
-}
 
 
-Halfedge Halfedge::next() const
-{
-    return Halfedge(mesh, mesh.halfedge_incidence_data[*this].next_index);
-}
-Halfedge Halfedge::twin() const {
-    return Halfedge(mesh, mesh.halfedge_incidence_data[*this].twin_index);
-}
 
-Vertex Halfedge::vertex() const
-{
-    return Vertex(mesh, mesh.halfedge_incidence_data[*this].vertex_index);
-}
-Vertex Halfedge::tip() const
+/*--------------------------------------------------------------------------------
+    Index-based traversal.
+--------------------------------------------------------------------------------*/
+void SurfaceMesh::traversal_error(const char *message)
 {
-    return next().vertex();
+    std::cerr << "mesh traversal error: " << message << "\n";
+    exit(EXIT_FAILURE);
 }
 
-Face Halfedge::face() const
-{
-    return Face(mesh, mesh.halfedge_incidence_data[*this].face_index);
-}
-Edge Halfedge::edge() const
+size_t SurfaceMesh::num_adjacent_vertices(VertexId vertex) const
 {
-    if (!mesh.locked()) {
-        std::cerr << "mesh traversal error: halfedge->edge traversal is only valid when the mesh is locked.\n";
-        exit(EXIT_FAILURE);
+    check_locked("Vertex::num_adjacent_vertices() is only valid when the mesh is locked.");
+    size_t n = 0;
+    for (auto he : UncheckedTraversal(*this).outgoing_halfedges(vertex)) {
+        (void) he;
+        n++;
     }
-    return Edge(mesh, mesh.halfedge_incidence_data[*this].edge_index);
+    return n;
 }
 
-Halfedge Face::halfedge() const
+size_t SurfaceMesh::num_face_vertices(FaceId face) const
 {
-    return Halfedge(mesh, mesh.face_incidence_data[*this].halfedge_index);
-}
-void Face::set_halfedge(Halfedge halfedge)
-{
-    mesh.face_incidence_data[*this].halfedge_index = halfedge.index();
-}
-size_t Face::num_vertices() const
-{
-    auto start = halfedge();
-    auto he = start;
-    int n = 0;
-    do {
+    size_t n = 0;
+    for (auto he : UncheckedTraversal(*this).face_halfedges(face)) {
+        (void) he;
         n++;
-    } while ((he = he.next()) != start);
+    }
     return n;
 }
 
-Halfedge Edge::a() const
-{
-    return Halfedge(mesh, mesh.edge_incidence_data[*this].halfedge_indices[0]);
-}
-Halfedge Edge::b() const
-{
-    return Halfedge(mesh, mesh.edge_incidence_data[*this].halfedge_indices[1]);
-}
-
 
 /*--------------------------------------------------------------------------------
     SurfaceMesh
 --------------------------------------------------------------------------------*/
 SurfaceMesh::SurfaceMesh() :
     vertex_incidence_data(*this),
-    halfedge_incidence_data(*this),
+    halfedge_incidence_data(halfedge_pool),
     edge_incidence_data(*this),
     face_incidence_data(*this),
     vertex_on_boundary(*this),
-    m_locked{false}
+    m_locked{false},
+    m_components_valid{false}
 {
 }
 
@@ -338,9 +407,44 @@ size_t SurfaceMesh::num_interior_edges() const
 }
 
 // Copy assignment.
+SurfaceMesh::SurfaceMesh(const SurfaceMesh &other) :
+    SurfaceMesh()
+{
+    *this = other;
+}
+
 SurfaceMesh &SurfaceMesh::operator=(const SurfaceMesh &other)
 {
-    assert(0); //todo: Implement this.
+    if (this == &other) return *this;
+    // The properties are replaced by copies of the other mesh's, which are made once the pools have been copied.
+    m_properties.clear();
+    vertex_pool.copy(other.vertex_pool);
+    halfedge_pool.copy(other.halfedge_pool);
+    edge_pool.copy(other.edge_pool);
+    face_pool.copy(other.face_pool);
+    vertex_incidence_data.copy(other.vertex_incidence_data);
+    halfedge_incidence_data.copy(other.halfedge_incidence_data);
+    edge_incidence_data.copy(other.edge_incidence_data);
+    face_incidence_data.copy(other.face_incidence_data);
+    vertex_on_boundary.copy(other.vertex_on_boundary);
+    halfedge_map = other.halfedge_map;
+
+    // The topology data is copied, with the handles moved over to this mesh.
+    m_boundary_loops.clear();
+    for (auto start : other.m_boundary_loops) {
+        m_boundary_loops.push_back(Halfedge(*this, start.index()));
+    }
+    m_connected_components.clear();
+    invalidate_connected_components(); // Recomputed on the next query.
+    m_locked = other.m_locked;
+    m_num_interior_vertices = other.m_num_interior_vertices;
+    m_num_interior_edges = other.m_num_interior_edges;
+
+    for (auto &other_property : other.m_properties) {
+        auto attachment = other_property.copy_to(*this, *other_property.attachment);
+        m_properties.push_back(Property{other_property.info, &pool(other_property.info.element_type),
+                                        std::unique_ptr<ElementAttachmentBase>(attachment), other_property.copy_to});
+    }
     return *this;
 }
 
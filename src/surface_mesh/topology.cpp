@@ -1,5 +1,6 @@
 #include "mesh_processing/mesh_processing.h"
 #include <algorithm>
+#include <atomic>
 
 
 std::vector<Halfedge> SurfaceMesh::boundary_loops()
@@ -19,13 +20,38 @@ bool SurfaceMesh::closed() const
     return m_boundary_loops.size() == 0;
 }
 
-bool SurfaceMesh::locked() const {
-    return m_locked;
+
+// Call function(index) for each active element of the pool, in parallel.
+template <typename Function>
+static void parallel_for_each_active(const ElementPool &pool, Function function)
+{
+    Parallel::for_range(0, pool.end_index(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            if (pool.is_active(i)) function(ElementIndex(i));
+        }
+    });
+}
+
+// Count the active elements of the pool for which predicate(index) is true, in parallel.
+template <typename Predicate>
+static size_t parallel_count_active(const ElementPool &pool, Predicate predicate)
+{
+    std::atomic<size_t> count(0);
+    Parallel::for_range(0, pool.end_index(), [&](size_t begin, size_t end) {
+        size_t chunk_count = 0;
+        for (size_t i = begin; i < end; i++) {
+            if (pool.is_active(i) && predicate(ElementIndex(i))) chunk_count += 1;
+        }
+        count += chunk_count;
+    });
+    return count;
 }
 
+
 void SurfaceMesh::lock()
 {
     if (m_locked) return;
+    Trace::Scope trace("SurfaceMesh::lock");
     
     // "Unlocked":
     //     - Halfedges do not need to have twins.
@@ -38,18 +64,31 @@ void SurfaceMesh::lock()
     //     - A boundary halfedge is known by the fact that face() is null.
     //     - Vertex->halfedge incidences have been set up for mesh traversal.
     //     - Edge handles can be used.
+    //
+    // The sweeps over all elements are independent per element (or are made so with a prefix sum),
+    // and are run in parallel with Parallel::num_threads() threads. Work proportional to the boundary is done serially.
+    // The result is the same as a serial sweep, whatever the number of threads.
 
-    HalfedgeAttachment<char> visited(*this); //note: Something goes wrong with bool (maybe because std::vector<bool> is actually a different data structure).
-    for (auto he : halfedges()) {
-        visited[he] = false; //todo: It would be convenient to have default values for attachments.
-    }
+    HalfedgeAttachment<char> visited(*this, false); //note: Something goes wrong with bool (maybe because std::vector<bool> is actually a different data structure).
 
     std::vector<std::vector<Halfedge>> loops(0);
-    
-    printf("lock(): Computing boundary loops.\n");
+
+    Trace::Scope phase("lock: boundary loops");
+    // Find the halfedges without twins, in index order. Each chunk of the halfedge index range is scanned in parallel.
+    size_t num_chunks = Parallel::default_num_chunks(halfedge_pool.end_index());
+    std::vector<std::vector<ElementIndex>> chunk_boundary_halfedges(num_chunks);
+    Parallel::for_chunks(0, halfedge_pool.end_index(), num_chunks, [&](size_t chunk, size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            if (halfedge_pool.is_active(i) && Halfedge(*this, i).twin().null()) {
+                chunk_boundary_halfedges[chunk].push_back(i);
+            }
+        }
+    });
     // Look for starting halfedges to form boundary loops.
-    for (auto start : halfedges()) {
-        if (start.twin().null() && !visited[start]) {
+    for (auto &boundary_halfedges : chunk_boundary_halfedges) {
+        for (ElementIndex start_index : boundary_halfedges) {
+            auto start = Halfedge(*this, start_index);
+            if (visited[start]) continue;
             // start is on an unvisited boundary loop.
             loops.push_back(std::vector<Halfedge>(0));
             auto &loop = loops[loops.size()-1];
@@ -69,6 +108,13 @@ void SurfaceMesh::lock()
     }
     
     m_boundary_loops.clear(); // m_boundary_loops will contain a starting halfedge for each boundary loop.
+    // Create all of the boundary halfedges at once, unless there are removed slots to reuse.
+    size_t num_boundary_halfedges = 0;
+    for (auto &loop : loops) num_boundary_halfedges += loop.size();
+    ElementIndex next_boundary_halfedge = InvalidElementIndex;
+    if (halfedge_pool.num_free_slots() == 0 && num_boundary_halfedges > 0) {
+        next_boundary_halfedge = halfedge_pool.add_n(num_boundary_halfedges);
+    }
     for (auto &loop : loops) {
         std::vector<Halfedge> boundary_halfedges;
         for (size_t i = 0; i < loop.size(); i++) {
@@ -77,9 +123,10 @@ void SurfaceMesh::lock()
             
             // Create a new boundary halfedge v->u, with a null face().
             assert(get_halfedge(v, u).null());
-            auto he = Halfedge(*this, halfedge_pool.add());
+            auto he = Halfedge(*this, next_boundary_halfedge != InvalidElementIndex ? next_boundary_halfedge++
+                                                                                    : halfedge_pool.add());
             // Add this to the halfedge_map, which is used to quickly find halfedges between two vertices.
-            halfedge_map[std::pair<ElementIndex,ElementIndex>(v.index(), u.index())] = he.index();
+            halfedge_map.insert(v.index(), u.index(), he.index());
             // Set up incidence information for this boundary halfedge.
             he.set_face(Face(*this, InvalidElementIndex));
             he.set_vertex(v);
@@ -95,7 +142,7 @@ void SurfaceMesh::lock()
         m_boundary_loops.push_back(boundary_halfedges[0]); // (The first boundary halfedge is the beginning of iterations around the boundary.)
     }
 
-    printf("lock(): Testing vertex manifoldness.\n");
+    phase.next("lock: vertex manifoldness");
     // Test vertex manifoldness.
     //------------------------------------------------------------
     // A non-manifold vertex has disjoint triangle fans.
@@ -118,140 +165,127 @@ void SurfaceMesh::lock()
     //      ---------
     // This is another sufficient condition for that vertex to be non-manifold.
     // These two conditions are necessary and sufficient. (todo: Need to properly prove this).
-    VertexAttachment<char> vertex_visited(*this);
-    for (auto v : vertices()) {
-        vertex_visited[v] = false;
-    }
+    VertexAttachment<char> vertex_visited(*this, false);
     for (auto start : m_boundary_loops) {
-        auto he = start;
-        do {
-            if (vertex_visited[he.vertex()]) {
+        for (auto v : start.loop_vertices()) {
+            if (vertex_visited[v]) {
                 std::cerr << "SurfaceMesh topology error: Non-manifold vertex.\n";
                 exit(EXIT_FAILURE);
             }
-            vertex_visited[he.vertex()] = true;
-        } while ((he = he.next()) != start);
+            vertex_visited[v] = true;
+        }
     }
 
     //------------------------------------------------------------
     // By now, the mesh has been topologically verified.
     //------------------------------------------------------------
 
-    printf("lock(): Adding vertex->halfedge incidences.\n");
+    phase.next("lock: vertex halfedges");
     // Add vertex->halfedge incidences.
     //------------------------------------------------------------
-    for (auto v : vertices()) {
-        vertex_visited[v] = false; // re-use this attachment.
-    }
-    // For each face, for all vertices on this face which have not had their halfedge set,
-    // set it to the relevant halfedge on this face.
+    // Each vertex is given its outgoing halfedge on the first face (in face index order) which is incident to it.
     // (This is a somewhat arbitrary choice. Each vertex needs just one of its outgoing halfedges.)
-    for (auto face : faces()) {
-        auto start = face.halfedge();
-        auto he = start;
-        do {
-            if (!vertex_visited[he.vertex()]) {
-                he.vertex().set_halfedge(he);
-                vertex_visited[he.vertex()] = true;
+    // In parallel, first find the least incident face index of each vertex with an atomic minimum,
+    // then sweep the faces again and set the halfedge from that face.
+    std::vector<std::atomic<ElementIndex>> first_face(vertex_pool.end_index());
+    Parallel::for_range(0, first_face.size(), [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            first_face[i].store(InvalidElementIndex, std::memory_order_relaxed);
+        }
+    });
+    parallel_for_each_active(face_pool, [&](ElementIndex face_index) {
+        for (auto v : Face(*this, face_index).vertices()) {
+            auto &vertex_first_face = first_face[v.index()];
+            ElementIndex current = vertex_first_face.load(std::memory_order_relaxed);
+            while (face_index < current && !vertex_first_face.compare_exchange_weak(current, face_index, std::memory_order_relaxed)) {}
+        }
+    });
+    vertex_visited.fill(false); // re-use this attachment.
+    parallel_for_each_active(face_pool, [&](ElementIndex face_index) {
+        // Only the thread sweeping a vertex's first face writes to that vertex.
+        for (auto he : Face(*this, face_index).halfedges()) {
+            auto v = he.vertex();
+            if (first_face[v.index()].load(std::memory_order_relaxed) == face_index && !vertex_visited[v]) {
+                v.set_halfedge(he);
+                vertex_visited[v] = true;
             }
-        } while ((he = he.next()) != start);
-    }
+        }
+    });
 
-    printf("lock(): Adding edge data.\n");
+    phase.next("lock: edges");
     // Add edge data. An "edge" only makes sense when the mesh is locked.
     //------------------------------------------------------------
-    for (auto he : halfedges()) {
-        visited[he] = false; // Re-use this attachment.
-    }
-    for (auto he : halfedges()) {
-        if (visited[he] || visited[he.twin()]) continue;
-        // Create a new edge.
-        auto edge = Edge(*this, edge_pool.add());
-        // Set up halfedges<->edge incidence data.
-        edge.set_halfedge_a(he);
-        edge.set_halfedge_b(he.twin());
-        he.set_edge(edge);
-        he.twin().set_edge(edge);
-        visited[he] = true;
-        visited[he.twin()] = true;
+    // Each halfedge pair gets one edge, created in the order of the pair's lesser halfedge index.
+    // Count the edges in each chunk of the halfedge index range, then (after a prefix sum) create the edges of each chunk in parallel.
+    edge_pool.clear();
+    num_chunks = Parallel::default_num_chunks(halfedge_pool.end_index());
+    std::vector<size_t> chunk_edge_offsets(num_chunks + 1, 0);
+    auto creates_edge = [&](ElementIndex i) {
+        return halfedge_pool.is_active(i) && i < Halfedge(*this, i).twin().index();
+    };
+    Parallel::for_chunks(0, halfedge_pool.end_index(), num_chunks, [&](size_t chunk, size_t begin, size_t end) {
+        size_t count = 0;
+        for (size_t i = begin; i < end; i++) {
+            if (creates_edge(i)) count += 1;
+        }
+        chunk_edge_offsets[chunk + 1] = count;
+    });
+    for (size_t chunk = 0; chunk < num_chunks; chunk++) {
+        chunk_edge_offsets[chunk + 1] += chunk_edge_offsets[chunk];
     }
+    ElementIndex first_edge = edge_pool.add_n(chunk_edge_offsets[num_chunks]);
+    Parallel::for_chunks(0, halfedge_pool.end_index(), num_chunks, [&](size_t chunk, size_t begin, size_t end) {
+        ElementIndex edge_index = first_edge + chunk_edge_offsets[chunk];
+        for (size_t i = begin; i < end; i++) {
+            if (!creates_edge(i)) continue;
+            auto he = Halfedge(*this, i);
+            auto edge = Edge(*this, edge_index++);
+            // Set up halfedges<->edge incidence data.
+            edge.set_halfedge_a(he);
+            edge.set_halfedge_b(he.twin());
+            he.set_edge(edge);
+            he.twin().set_edge(edge);
+        }
+    });
 
-    printf("lock(): Computing connected components.\n");
-    // // Compute connected components
-    // //------------------------------------------------------------
-    // m_connected_components.clear();
-    // // For each face, store a "visited" flag (which starts at false).
-    // // Repeat this process until connected components are found:
-    // //     Find the next face which is not visited.
-    // //     This corresponds to a connected component.
-    // //     Run search(face), which:
-    // //         Marks face as visited.
-    // //         Recurs: Finds adjacent non-visited faces, and runs search(face) on them.
-    // FaceAttachment<char> face_visited(*this);
-    // for (auto face : faces()) face_visited[face] = false;
-    // std::function<void(Face)> search = [&](Face face) {
-    //     face_visited[face] = true;
-    //     auto start = face.halfedge();
-    //     auto he = start;
-    //     do {
-    //         assert(!he.twin().null());
-    //         if (!he.twin().face().null() && !face_visited[he.twin().face()]) {
-    //             search(he.twin().face());
-    //         }
-    //     } while ((he = he.next()) != start);
-    // };
-    // for (auto face : faces()) {
-    //     if (!face_visited[face]) {
-    //         m_connected_components.push_back(face);
-    //         search(face);
-    //     }
-    // };
-    
+    phase.next("lock: boundary cache");
     // Cache vertex boundary-ness, and count the number of interior vertices.
-    for (auto v : vertices()) {
-        vertex_on_boundary[v] = 0;
-    }
+    parallel_for_each_active(vertex_pool, [&](ElementIndex i) {
+        vertex_on_boundary[Vertex(*this, i)] = 0;
+    });
     for (auto start : m_boundary_loops) {
-        auto he = start;
-        do {
-            vertex_on_boundary[he.vertex()] = 1;
-            he = he.next();
-        } while (he != start);
+        for (auto v : start.loop_vertices()) {
+            vertex_on_boundary[v] = 1;
+        }
     }
 
     // For each vertex on the boundary, make sure that the outgoing halfedge
     // has a nonnull face, and that this is the first face, such that all faces can be traversed.
     for (auto start : m_boundary_loops) {
-        auto he = start;
-        do {
-            auto v = he.vertex();
+        for (auto he : start.loop()) {
             assert(!he.twin().next().null());
-            v.set_halfedge(he.twin().next());
-            he = he.next();
-        } while (he != start);
+            he.vertex().set_halfedge(he.twin().next());
+        }
     }
     m_locked = true;
     
     // Post-lock changes. NOTE: Be careful! Try to minimize the number of post-lock changes,
     // and make sure they don't assume that the whole mesh is "fully locked" (as the data below still has to be initialized).
     // Count the number of interior vertices.
-    m_num_interior_vertices = 0;
-    for (auto v : vertices()) {
-        if (!v.on_boundary()) m_num_interior_vertices += 1;
-    }
+    m_num_interior_vertices = parallel_count_active(vertex_pool, [&](ElementIndex i) {
+        return !Vertex(*this, i).on_boundary();
+    });
     // Count the number of interior edges.
-    m_num_interior_edges = 0;
-    for (auto edge : edges()) {
-        if (!edge.on_boundary()) m_num_interior_edges += 1;
-    }
-
-    printf("lock(): Complete.\n");
+    m_num_interior_edges = parallel_count_active(edge_pool, [&](ElementIndex i) {
+        return !Edge(*this, i).on_boundary();
+    });
 }
 
 
 void SurfaceMesh::unlock()
 {
     if (!m_locked) return;
+    Trace::Scope trace("SurfaceMesh::unlock");
 
     // Remove boundary loops.
     for (Halfedge start : boundary_loops()) {
@@ -270,17 +304,17 @@ void SurfaceMesh::unlock()
             // IMPORTANT: Remove the halfedge from the vertex_indices->halfedge map.
             // Usually, the halfedge tip can be retrieved by he.next().vertex(). However, while deleting this loop of halfedges,
             // there is a special case when removing the last halfedge, as its next() is now invalid.
-            auto vertex_indices = he.next() == start ? std::pair<ElementIndex, ElementIndex>(he.vertex().index(), start_vertex.index())
-                                                     : std::pair<ElementIndex, ElementIndex>(he.vertex().index(), he.next().vertex().index());
-            auto found = halfedge_map.find(vertex_indices);
-            assert(found != halfedge_map.end());
-            halfedge_map.erase(found);
+            auto tip_index = he.next() == start ? start_vertex.index() : he.next().vertex().index();
+            bool found = halfedge_map.erase(he.vertex().index(), tip_index);
+            assert(found);
+            (void) found;
             // Remove the halfedge.
             halfedge_pool.remove(he.index());
         }
     }
 
-    //TODO: Remove edges.
+    // Remove edges.
+    edge_pool.clear();
 
     m_locked = false;
 }
@@ -288,18 +322,111 @@ void SurfaceMesh::unlock()
 
 
 
+void SurfaceMesh::update_connected_components() const
+{
+    std::lock_guard<std::mutex> lock(m_components_mutex);
+    if (m_components_valid) return;
+    Trace::Scope trace("SurfaceMesh::connected_components");
+    SurfaceMesh &mesh = const_cast<SurfaceMesh &>(*this); // Handles and attachments need a non-const mesh. Only the cache is written.
+    if (!m_component_labels) m_component_labels.reset(new FaceAttachment<uint32_t>(mesh));
+    FaceAttachment<uint32_t> &labels = *m_component_labels;
+
+    // Union-find over the face adjacencies, in parallel.
+    // Each face's parent has a lesser or equal index, so the root of a set is its least face. Two sets are joined by pointing the
+    // greater root at the lesser with a compare-exchange, which fails (and is retried) if another thread has joined that root first.
+    size_t n = face_pool.end_index();
+    std::vector<std::atomic<ElementIndex>> parent(n);
+    Parallel::for_range(0, n, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            parent[i].store(ElementIndex(i), std::memory_order_relaxed);
+        }
+    });
+    auto find = [&](ElementIndex x) {
+        while (true) {
+            ElementIndex p = parent[x].load(std::memory_order_relaxed);
+            if (p == x) return x;
+            // Path halving: point x at its grandparent, and continue from there.
+            ElementIndex grandparent = parent[p].load(std::memory_order_relaxed);
+            if (grandparent != p) parent[x].compare_exchange_weak(p, grandparent, std::memory_order_relaxed);
+            x = grandparent;
+        }
+    };
+    auto unite = [&](ElementIndex a, ElementIndex b) {
+        while (true) {
+            a = find(a);
+            b = find(b);
+            if (a == b) return;
+            if (a < b) std::swap(a, b);
+            ElementIndex expected = a;
+            if (parent[a].compare_exchange_strong(expected, b, std::memory_order_relaxed)) return;
+        }
+    };
+    // Each pair of twin halfedges is seen from its lesser halfedge. Boundary halfedges have no face, and (when unlocked) halfedges
+    // without a twin have no neighbour.
+    parallel_for_each_active(halfedge_pool, [&](ElementIndex i) {
+        ElementIndex twin = halfedge_incidence_data.twin(i);
+        if (twin == InvalidElementIndex || twin < i) return;
+        ElementIndex face = halfedge_incidence_data.face(i);
+        ElementIndex twin_face = halfedge_incidence_data.face(twin);
+        if (face != InvalidElementIndex && twin_face != InvalidElementIndex) unite(face, twin_face);
+    });
+
+    // Number the roots in index order. The roots of each chunk of the face index range are counted, then (after a prefix sum)
+    // numbered in parallel, so the numbering doesn't depend on the thread count.
+    auto is_root = [&](size_t i) {
+        return face_pool.is_active(i) && parent[i].load(std::memory_order_relaxed) == i;
+    };
+    size_t num_chunks = Parallel::default_num_chunks(n);
+    std::vector<size_t> chunk_offsets(num_chunks + 1, 0);
+    Parallel::for_chunks(0, n, num_chunks, [&](size_t chunk, size_t begin, size_t end) {
+        size_t count = 0;
+        for (size_t i = begin; i < end; i++) {
+            if (is_root(i)) count += 1;
+        }
+        chunk_offsets[chunk + 1] = count;
+    });
+    for (size_t chunk = 0; chunk < num_chunks; chunk++) {
+        chunk_offsets[chunk + 1] += chunk_offsets[chunk];
+    }
+    m_connected_components.assign(chunk_offsets[num_chunks], Face());
+    Parallel::for_chunks(0, n, num_chunks, [&](size_t chunk, size_t begin, size_t end) {
+        uint32_t component = uint32_t(chunk_offsets[chunk]);
+        for (size_t i = begin; i < end; i++) {
+            if (!is_root(i)) continue;
+            labels[FaceId(i)] = component;
+            m_connected_components[component] = Face(mesh, ElementIndex(i));
+            component += 1;
+        }
+    });
+    // Label the other faces with the number of their root.
+    parallel_for_each_active(face_pool, [&](ElementIndex i) {
+        ElementIndex root = find(i);
+        if (root != i) labels[FaceId(i)] = labels[FaceId(root)];
+    });
+    m_components_valid = true;
+}
+
 std::vector<Face> SurfaceMesh::connected_components()
 {
     assert(locked());
+    update_connected_components();
     return m_connected_components;
 }
 
 size_t SurfaceMesh::num_connected_components() const
 {
     assert(locked());
+    update_connected_components();
     return m_connected_components.size();
 }
 
+const FaceAttachment<uint32_t> &SurfaceMesh::connected_component_labels() const
+{
+    assert(locked());
+    update_connected_components();
+    return *m_component_labels;
+}
+
 bool SurfaceMesh::connected() const
 {
     // note: 0 connected components is not considered "closed".
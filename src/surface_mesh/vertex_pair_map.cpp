@@ -0,0 +1,132 @@
+#include "mesh_processing/mesh_processing.h"
+
+// The table is grown when it becomes more than 3/4 full.
+#define MAX_LOAD_NUMERATOR 3
+#define MAX_LOAD_DENOMINATOR 4
+#define MIN_NUM_SLOTS 16
+
+VertexPairMap::VertexPairMap() :
+    m_slots(0),
+    m_mask{0},
+    m_shift{64},
+    m_size{0}
+{}
+
+
+void VertexPairMap::insert(ElementIndex u, ElementIndex v, ElementIndex value)
+{
+    assert(u != InvalidElementIndex);
+    if ((m_size + 1) * MAX_LOAD_DENOMINATOR > m_slots.size() * MAX_LOAD_NUMERATOR) {
+        rehash(std::max<size_t>(MIN_NUM_SLOTS, 2*m_slots.size()));
+    }
+    size_t i = slot_index(u, v);
+    while (true) {
+        Slot &slot = m_slots[i];
+        if (slot.u == InvalidElementIndex) {
+            slot.u = u;
+            slot.v = v;
+            slot.value = value;
+            m_size += 1;
+            return;
+        }
+        if (slot.u == u && slot.v == v) {
+            slot.value = value;
+            return;
+        }
+        i = (i + 1) & m_mask;
+    }
+}
+
+
+bool VertexPairMap::erase(ElementIndex u, ElementIndex v)
+{
+    if (m_size == 0) return false;
+    size_t i = slot_index(u, v);
+    while (true) {
+        Slot &slot = m_slots[i];
+        if (slot.u == InvalidElementIndex) return false;
+        if (slot.u == u && slot.v == v) break;
+        i = (i + 1) & m_mask;
+    }
+    // Backward-shift deletion.
+    // Entries after the hole which would be unreachable (their probe sequence passes through the hole)
+    // are moved back into it, until an empty slot is reached.
+    size_t hole = i;
+    size_t j = i;
+    while (true) {
+        j = (j + 1) & m_mask;
+        Slot &slot = m_slots[j];
+        if (slot.u == InvalidElementIndex) break;
+        size_t home = slot_index(slot.u, slot.v);
+        // The entry at j can fill the hole if its home slot is not cyclically in (hole, j].
+        if (((j - home) & m_mask) >= ((j - hole) & m_mask)) {
+            m_slots[hole] = slot;
+            hole = j;
+        }
+    }
+    m_slots[hole].u = InvalidElementIndex;
+    m_size -= 1;
+    return true;
+}
+
+
+void VertexPairMap::reserve(size_t n)
+{
+    size_t num_slots = std::max<size_t>(MIN_NUM_SLOTS, m_slots.size());
+    while (n * MAX_LOAD_DENOMINATOR > num_slots * MAX_LOAD_NUMERATOR) {
+        num_slots *= 2;
+    }
+    if (num_slots != m_slots.size()) rehash(num_slots);
+}
+
+
+void VertexPairMap::shrink_to_fit()
+{
+    if (m_size == 0) {
+        std::vector<Slot>().swap(m_slots);
+        m_mask = 0;
+        m_shift = 64;
+        return;
+    }
+    size_t num_slots = MIN_NUM_SLOTS;
+    while (m_size * MAX_LOAD_DENOMINATOR > num_slots * MAX_LOAD_NUMERATOR) {
+        num_slots *= 2;
+    }
+    if (num_slots < m_slots.size()) rehash(num_slots);
+}
+
+
+void VertexPairMap::clear()
+{
+    for (auto &slot : m_slots) {
+        slot.u = InvalidElementIndex;
+    }
+    m_size = 0;
+}
+
+
+void VertexPairMap::rehash(size_t new_num_slots)
+{
+    assert((new_num_slots & (new_num_slots - 1)) == 0); // Must be a power of two.
+    std::vector<Slot> old_slots(new_num_slots);
+    std::swap(old_slots, m_slots);
+    for (auto &slot : m_slots) {
+        slot.u = InvalidElementIndex;
+    }
+    m_mask = new_num_slots - 1;
+    m_shift = 64;
+    for (size_t n = new_num_slots; n > 1; n >>= 1) m_shift -= 1;
+
+    for (auto &slot : old_slots) {
+        if (slot.u == InvalidElementIndex) continue;
+        size_t i = slot_index(slot.u, slot.v);
+        while (m_slots[i].u != InvalidElementIndex) {
+            i = (i + 1) & m_mask;
+        }
+        m_slots[i] = slot;
+    }
+}
+
+#undef MAX_LOAD_NUMERATOR
+#undef MAX_LOAD_DENOMINATOR
+#undef MIN_NUM_SLOTS
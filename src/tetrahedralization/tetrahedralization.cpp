@@ -5,6 +5,8 @@
 CompactTetMesh tetgen_tetrahedralize(SurfaceGeometry &geom)
 {
     assert(geom.mesh.locked() && geom.mesh.closed());
+    Trace::Scope trace("tetgen_tetrahedralize");
+    Trace::Scope phase("tetgen: build input");
     
     // Create tetgen input PLC (piecewise linear complex).
     //------------------------------------------------------------
@@ -64,13 +66,11 @@ CompactTetMesh tetgen_tetrahedralize(SurfaceGeometry &geom)
         p->numberofvertices = face.num_vertices();
         p->vertexlist = &vertex_indices[vertex_indices_offset];
         // Traverse the face to get vertices, and look up their contiguous index to store in the vertexlist.
-        auto start = face.halfedge();
-        auto he = start;
         size_t vertex_index = 0;
-        do {
-            p->vertexlist[vertex_index] = contiguous_vertex_indices[he.vertex()];
+        for (auto v : face.vertices()) {
+            p->vertexlist[vertex_index] = contiguous_vertex_indices[v];
             vertex_index += 1;
-        } while ((he = he.next()) != start);
+        }
 
         vertex_indices_offset += p->numberofvertices;
         facet_index += 1;
@@ -78,6 +78,7 @@ CompactTetMesh tetgen_tetrahedralize(SurfaceGeometry &geom)
 
     // Retrieve tetgen output.
     //------------------------------------------------------------
+    phase.next("tetgen: tetrahedralize");
     tetgenio out;
     auto flags = std::string("pq1.414a0.1");
     tetrahedralize(const_cast<char *>(flags.c_str()), &in, &out);
@@ -89,6 +90,7 @@ CompactTetMesh tetgen_tetrahedralize(SurfaceGeometry &geom)
     // tet_mesh.m_num_vertices = out
 
 
+    phase.next("tetgen: save");
     out.save_nodes("barout");
     out.save_elements("barout");
     out.save_faces("barout");
@@ -0,0 +1,114 @@
+#include "mesh_processing/mesh_processing.h"
+#include <mutex>
+#include <unordered_map>
+namespace Trace {
+
+std::atomic<Mode> g_mode{Mode::Silent};
+
+namespace {
+
+struct Event {
+    const char *name;
+    Clock::time_point start;
+    Clock::time_point end;
+    int thread;
+};
+
+// Recording takes a lock, so it is only cheap for scopes around bulk work, which is what the library traces.
+std::mutex g_mutex;
+std::vector<Counter> g_counters;
+std::unordered_map<std::string, size_t> g_counter_indices; // Scope name to index in g_counters.
+std::vector<Event> g_events;
+Clock::time_point g_epoch = Clock::now(); // Chrome timestamps are relative to this.
+
+// Threads are numbered in the order they first record something.
+std::atomic<int> g_num_threads{0};
+thread_local int t_thread = -1;
+
+void write_json_string(FILE *file, const char *string)
+{
+    fputc('"', file);
+    for (const char *c = string; *c != '\0'; c++) {
+        if (*c == '"' || *c == '\\') fputc('\\', file);
+        fputc(*c, file);
+    }
+    fputc('"', file);
+}
+
+} // namespace
+
+
+void set_mode(Mode mode)
+{
+    g_mode.store(mode, std::memory_order_relaxed);
+}
+
+void record(const char *name, Clock::time_point start, Clock::time_point end)
+{
+    Mode current_mode = mode();
+    if (current_mode == Mode::Silent) return; // The mode was changed during the scope.
+    if (t_thread < 0) t_thread = g_num_threads++;
+    double seconds = std::chrono::duration<double>(end - start).count();
+
+    std::lock_guard<std::mutex> lock(g_mutex);
+    auto found = g_counter_indices.find(name);
+    if (found == g_counter_indices.end()) {
+        found = g_counter_indices.emplace(name, g_counters.size()).first;
+        g_counters.push_back(Counter{name, 0, 0, seconds, seconds});
+    }
+    Counter &counter = g_counters[found->second];
+    counter.count += 1;
+    counter.total_seconds += seconds;
+    counter.min_seconds = std::min(counter.min_seconds, seconds);
+    counter.max_seconds = std::max(counter.max_seconds, seconds);
+    if (current_mode == Mode::Chrome) {
+        g_events.push_back(Event{name, start, end, t_thread});
+    }
+}
+
+std::vector<Counter> counters()
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    return g_counters;
+}
+
+void printout()
+{
+    auto all_counters = counters();
+    printf("%-40s %8s %12s %12s %12s %12s\n", "scope", "count", "total ms", "mean ms", "min ms", "max ms");
+    for (auto &counter : all_counters) {
+        printf("%-40s %8zu %12.3f %12.3f %12.3f %12.3f\n", counter.name.c_str(), counter.count,
+               1e3 * counter.total_seconds, 1e3 * counter.total_seconds / counter.count,
+               1e3 * counter.min_seconds, 1e3 * counter.max_seconds);
+    }
+}
+
+bool write_chrome_trace(const std::string &filename)
+{
+    FILE *file = fopen(filename.c_str(), "w");
+    if (file == nullptr) return false;
+    std::lock_guard<std::mutex> lock(g_mutex);
+    // Complete ("X") events, with timestamps and durations in microseconds.
+    fprintf(file, "{\"traceEvents\":[\n");
+    for (size_t i = 0; i < g_events.size(); i++) {
+        const Event &event = g_events[i];
+        double start = std::chrono::duration<double, std::micro>(event.start - g_epoch).count();
+        double duration = std::chrono::duration<double, std::micro>(event.end - event.start).count();
+        fprintf(file, "{\"name\":");
+        write_json_string(file, event.name);
+        fprintf(file, ",\"cat\":\"mesh_processing\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%d}%s\n",
+                start, duration, event.thread, i + 1 < g_events.size() ? "," : "");
+    }
+    fprintf(file, "],\"displayTimeUnit\":\"ms\"}\n");
+    return fclose(file) == 0;
+}
+
+void reset()
+{
+    std::lock_guard<std::mutex> lock(g_mutex);
+    g_counters.clear();
+    g_counter_indices.clear();
+    g_events.clear();
+}
+
+}; // namespace Trace